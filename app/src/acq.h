@@ -0,0 +1,59 @@
+/*	Aquisição: DAC gerando a forma de onda e ADC amostrando frames por DMA
+ *
+ * 	Na placa (acq_stm32.c) o DAC1 é disparado pelo TIM3 e o ADC1 pelo TIM8, com
+ * 	PA4 (DAC1_OUT1) ligado em PA0 (ADC1_IN1). No native_sim (acq_sim.c) o mesmo
+ * 	laço é emulado em software.
+ */
+
+#ifndef APP_SRC_ACQ_H_
+#define APP_SRC_ACQ_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Chamada (em contexto de interrupção) quando o frame do ADC em done está
+// completo. Retorna o buffer do frame seguinte: done mantém a aquisição
+// circular, outro buffer (de mesmo comprimento) troca o destino do DMA, o que
+// só custa uma reprogramação por frame.
+typedef uint16_t *(*acq_frame_cb_t)(uint16_t *done);
+
+// Chamada (em contexto de interrupção) pelo watchdog analógico
+typedef void (*acq_awd_cb_t)(void);
+
+// Inicializa os periféricos, sem iniciar a aquisição nem o DAC
+void acq_init(acq_frame_cb_t frame_cb);
+
+// Inicia a aquisição de frames de len amostras, o primeiro em buf
+void acq_adc_start(uint16_t *buf, size_t len);
+
+void acq_adc_stop(void);
+
+// Amostras já convertidas desde o início do frame que o último callback de
+// frame entregou ao DMA. Passa de len se o fim desse frame ainda não foi
+// entregue. Deve ser chamada com as interrupções bloqueadas.
+size_t acq_adc_position(void);
+
+// Arma o watchdog analógico do ADC: cb é chamada na primeira amostra fora de
+// [low, high] (códigos de 12 bits) e o watchdog se desarma. A comparação é
+// feita pelo hardware, sem custo por amostra.
+void acq_awd_start(uint16_t low, uint16_t high, acq_awd_cb_t cb);
+
+void acq_awd_stop(void);
+
+// Ajusta o gatilho do ADC para a taxa mais próxima de fs_hz. Só pode ser
+// chamada com a aquisição parada. Retorna a taxa obtida.
+uint32_t acq_adc_set_rate(uint32_t fs_hz);
+
+// Taxa de amostragem atual do ADC
+uint32_t acq_adc_get_rate(void);
+
+// (Re)inicia o DAC tocando wave em loop, len amostras por período
+void acq_dac_start(const uint16_t *wave, size_t len);
+
+// Taxa de atualização do DAC (amostras da tabela por segundo)
+uint32_t acq_dac_get_rate(void);
+
+// k_cycle_get_32() no fim do último frame completo
+uint32_t acq_frame_cycles(void);
+
+#endif /* APP_SRC_ACQ_H_ */
@@ -0,0 +1,269 @@
+/*	Emulação do laço DAC -> ADC da bancada no native_sim
+ *
+ * 	Reproduz PA4 (DAC1_OUT1) ligado em PA0 (ADC1_IN1): o DAC segura cada amostra
+ * 	da tabela por um período do TIM3 e o ADC amostra a saída a cada período do
+ * 	TIM8. Os dois timers contam o mesmo clock (CONFIG_APP_ACQ_SIM_TIMER_HZ), com
+ * 	um erro opcional em ppm no clock do DAC. O caminho analógico aplica ganho,
+ * 	offset, atraso e ruído gaussiano antes da quantização em 12 bits.
+ *
+ * 	Cada frame é gerado por um k_timer no instante (em tempo simulado) em que o
+ * 	ADC converteria a última amostra, e então o callback de frame é chamado
+ * 	como faria o DMA. O watchdog analógico é emulado varrendo o frame gerado
+ * 	antes de entregá-lo, na ordem em que o hardware compararia as amostras.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/spinlock.h>
+#include <zephyr/sys/util.h>
+
+#include <math.h>
+
+#include "acq.h"
+
+// ARR + 1 do TIM3 e do TIM8 na placa (cerca de 15,36 kHz com 170 MHz)
+#define ACQ_SIM_PERIOD 11068
+#define ACQ_SIM_ADC_MAX 4095
+
+#define ACQ_SIM_GAIN (CONFIG_APP_ACQ_SIM_GAIN_PERMILLE / 1000.0f)
+#define ACQ_SIM_DELAY_S (CONFIG_APP_ACQ_SIM_DELAY_NS * 1e-9)
+#define ACQ_SIM_DAC_CLOCK_HZ (CONFIG_APP_ACQ_SIM_TIMER_HZ * (1.0 + (CONFIG_APP_ACQ_SIM_CLOCK_PPM * 1e-6)))
+
+static acq_frame_cb_t acq_frame_cb;
+static uint32_t acq_frame_stamp;
+
+static struct k_spinlock acq_lock;
+static struct k_timer acq_timer;
+
+// ADC: ticks do TIM8 por amostra ((PSC + 1) * (ARR + 1)) e estado do "DMA"
+static uint32_t acq_adc_ticks = ACQ_SIM_PERIOD;
+static uint16_t *acq_adc_buf;
+static size_t acq_adc_len;
+static bool acq_adc_running;
+static double acq_adc_t0;
+static uint64_t acq_adc_sample;
+
+// DAC: tabela em loop desde acq_dac_t0; antes disso a saída fica em zero
+static const uint16_t *acq_dac_wave;
+static size_t acq_dac_len;
+static double acq_dac_t0;
+
+// Watchdog analógico: janela [low, high] e posição da amostra que o disparou
+static acq_awd_cb_t acq_awd_cb;
+static uint16_t acq_awd_low;
+static uint16_t acq_awd_high;
+static bool acq_awd_scanning;
+static size_t acq_awd_pos;
+
+static uint32_t acq_noise_state = 0x2545f491;
+
+static double acq_sim_now(void)
+{
+	return (double)k_uptime_ticks() / CONFIG_SYS_CLOCK_TICKS_PER_SEC;
+}
+
+static double acq_sim_adc_rate(void)
+{
+	return (double)CONFIG_APP_ACQ_SIM_TIMER_HZ / acq_adc_ticks;
+}
+
+static double acq_sim_dac_rate(void)
+{
+	return ACQ_SIM_DAC_CLOCK_HZ / ACQ_SIM_PERIOD;
+}
+
+// Normal padrão aproximada pela soma de 12 uniformes (xorshift32)
+static float acq_sim_noise(void)
+{
+	float sum = 0.0f;
+
+	for (int i = 0; i < 12; i++)
+	{
+		acq_noise_state ^= acq_noise_state << 13;
+		acq_noise_state ^= acq_noise_state >> 17;
+		acq_noise_state ^= acq_noise_state << 5;
+		sum += (float)acq_noise_state * (1.0f / 4294967296.0f);
+	}
+
+	return sum - 6.0f;
+}
+
+static void acq_sim_fill_frame(void)
+{
+	double fs_dac = acq_sim_dac_rate();
+	double ratio = fs_dac / acq_sim_adc_rate();
+
+	// Posição na tabela do DAC (em amostras) quando o ADC converte a amostra n:
+	// base + n * ratio. Separado assim, com os dois timers iguais e partindo
+	// juntos, a posição é exatamente n.
+	double base = (acq_adc_t0 - acq_dac_t0 - ACQ_SIM_DELAY_S) * fs_dac;
+
+	for (size_t i = 0; i < acq_adc_len; i++)
+	{
+		double pos = base + ((double)(acq_adc_sample + i) * ratio);
+		float v = 0.0f;
+
+		if ((acq_dac_wave != NULL) && (pos >= 0.0))
+		{
+			v = acq_dac_wave[(uint64_t)pos % acq_dac_len];
+		}
+
+		v = (v * ACQ_SIM_GAIN) + CONFIG_APP_ACQ_SIM_OFFSET_LSB;
+		if (CONFIG_APP_ACQ_SIM_NOISE_LSB > 0)
+		{
+			v += CONFIG_APP_ACQ_SIM_NOISE_LSB * acq_sim_noise();
+		}
+
+		acq_adc_buf[i] = CLAMP(lroundf(v), 0, ACQ_SIM_ADC_MAX);
+	}
+
+	acq_adc_sample += acq_adc_len;
+}
+
+// Agenda o timer para quando a última amostra do próximo frame é convertida
+static void acq_sim_schedule(void)
+{
+	double t = acq_adc_t0 + ((double)(acq_adc_sample + acq_adc_len) / acq_sim_adc_rate());
+
+	k_timer_start(&acq_timer, K_TIMEOUT_ABS_TICKS((k_ticks_t)ceil(t * CONFIG_SYS_CLOCK_TICKS_PER_SEC)), K_NO_WAIT);
+}
+
+// Compara as amostras do frame com a janela do watchdog, que o callback pode
+// rearmar com outra janela no meio do frame
+static void acq_sim_awd_scan(const uint16_t *buf, size_t len)
+{
+	acq_awd_scanning = true;
+
+	for (size_t i = 0; (i < len) && (acq_awd_cb != NULL); i++)
+	{
+		if ((buf[i] < acq_awd_low) || (buf[i] > acq_awd_high))
+		{
+			acq_awd_cb_t cb = acq_awd_cb;
+
+			acq_awd_cb = NULL;
+			acq_awd_pos = i + 1;
+			cb();
+		}
+	}
+
+	acq_awd_scanning = false;
+}
+
+static void acq_sim_timer_fn(struct k_timer *timer)
+{
+	ARG_UNUSED(timer);
+
+	k_spinlock_key_t key = k_spin_lock(&acq_lock);
+
+	if (!acq_adc_running)
+	{
+		k_spin_unlock(&acq_lock, key);
+		return;
+	}
+
+	uint16_t *done = acq_adc_buf;
+
+	acq_sim_fill_frame();
+	acq_sim_schedule();
+	acq_frame_stamp = k_cycle_get_32();
+	k_spin_unlock(&acq_lock, key);
+
+	acq_sim_awd_scan(done, acq_adc_len);
+
+	uint16_t *next = acq_frame_cb(done);
+
+	key = k_spin_lock(&acq_lock);
+	acq_adc_buf = next;
+	k_spin_unlock(&acq_lock, key);
+}
+
+void acq_init(acq_frame_cb_t frame_cb)
+{
+	acq_frame_cb = frame_cb;
+	k_timer_init(&acq_timer, acq_sim_timer_fn, NULL);
+}
+
+void acq_adc_start(uint16_t *buf, size_t len)
+{
+	k_spinlock_key_t key = k_spin_lock(&acq_lock);
+
+	acq_adc_buf = buf;
+	acq_adc_len = len;
+	acq_adc_t0 = acq_sim_now();
+	acq_adc_sample = 0;
+	acq_adc_running = true;
+	acq_sim_schedule();
+	k_spin_unlock(&acq_lock, key);
+}
+
+void acq_adc_stop(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&acq_lock);
+
+	acq_adc_running = false;
+	k_spin_unlock(&acq_lock, key);
+
+	k_timer_stop(&acq_timer);
+}
+
+size_t acq_adc_position(void)
+{
+	if (acq_awd_scanning)
+	{
+		return acq_awd_pos;
+	}
+
+	// Amostras convertidas até agora além das já entregues em frames
+	double n = (acq_sim_now() - acq_adc_t0) * acq_sim_adc_rate();
+	uint64_t converted = (n > 0.0) ? (uint64_t)n : 0;
+
+	return (converted > acq_adc_sample) ? (size_t)MIN(converted - acq_adc_sample, 2 * acq_adc_len - 1) : 0;
+}
+
+void acq_awd_start(uint16_t low, uint16_t high, acq_awd_cb_t cb)
+{
+	acq_awd_low = low;
+	acq_awd_high = high;
+	acq_awd_cb = cb;
+}
+
+void acq_awd_stop(void)
+{
+	acq_awd_cb = NULL;
+}
+
+// Mesma quantização do tim8_set_rate da placa
+uint32_t acq_adc_set_rate(uint32_t fs_hz)
+{
+	uint32_t ticks = CONFIG_APP_ACQ_SIM_TIMER_HZ / fs_hz;
+	uint32_t prescaler = (ticks - 1) / 65536;
+
+	acq_adc_ticks = (prescaler + 1) * (ticks / (prescaler + 1));
+
+	return acq_adc_get_rate();
+}
+
+uint32_t acq_adc_get_rate(void)
+{
+	return CONFIG_APP_ACQ_SIM_TIMER_HZ / acq_adc_ticks;
+}
+
+void acq_dac_start(const uint16_t *wave, size_t len)
+{
+	k_spinlock_key_t key = k_spin_lock(&acq_lock);
+
+	acq_dac_wave = wave;
+	acq_dac_len = len;
+	acq_dac_t0 = acq_sim_now();
+	k_spin_unlock(&acq_lock, key);
+}
+
+// Taxa nominal: o firmware não enxerga o erro de clock do DAC
+uint32_t acq_dac_get_rate(void)
+{
+	return CONFIG_APP_ACQ_SIM_TIMER_HZ / ACQ_SIM_PERIOD;
+}
+
+uint32_t acq_frame_cycles(void)
+{
+	return acq_frame_stamp;
+}
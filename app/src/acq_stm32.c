@@ -0,0 +1,663 @@
+/*	Aquisição na NUCLEO-G431RB pela HAL do STM32
+ *
+ * 	DAC1 (PA4) disparado pelo TIM3 e ADC1 (PA0) disparado pelo TIM8, ambos
+ * 	por DMA circular. Quando o callback de frame pede outro buffer, o canal do
+ * 	ADC é reapontado no fim do frame, bem antes da próxima conversão. O
+ * 	watchdog analógico 1 do ADC1 vigia o mesmo canal para o gatilho do modo
+ * 	osciloscópio. Código de inicialização gerado pelo STM32CubeMX.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/irq.h>
+
+#include <stm32g431xx.h>
+
+#include "acq.h"
+
+ADC_HandleTypeDef hadc1;
+DMA_HandleTypeDef hdma_adc1;
+
+DAC_HandleTypeDef hdac1;
+DMA_HandleTypeDef hdma_dac1_ch1;
+
+TIM_HandleTypeDef htim3;
+TIM_HandleTypeDef htim8;
+
+static void MX_ADC1_Init(void)
+{
+
+	/* USER CODE BEGIN ADC1_Init 0 */
+
+	/* USER CODE END ADC1_Init 0 */
+
+	ADC_MultiModeTypeDef multimode = {0};
+	ADC_AnalogWDGConfTypeDef AnalogWDGConfig = {0};
+	ADC_ChannelConfTypeDef sConfig = {0};
+
+	/* USER CODE BEGIN ADC1_Init 1 */
+
+	/* USER CODE END ADC1_Init 1 */
+
+	/** Common config
+	 */
+	hadc1.Instance = ADC1;
+	hadc1.Init.ClockPrescaler = ADC_CLOCK_SYNC_PCLK_DIV4;
+	hadc1.Init.Resolution = ADC_RESOLUTION_12B;
+	hadc1.Init.DataAlign = ADC_DATAALIGN_RIGHT;
+	hadc1.Init.GainCompensation = 0;
+	hadc1.Init.ScanConvMode = ADC_SCAN_DISABLE;
+	hadc1.Init.EOCSelection = ADC_EOC_SINGLE_CONV;
+	hadc1.Init.LowPowerAutoWait = DISABLE;
+	hadc1.Init.ContinuousConvMode = DISABLE;
+	hadc1.Init.NbrOfConversion = 1;
+	hadc1.Init.DiscontinuousConvMode = DISABLE;
+	hadc1.Init.ExternalTrigConv = ADC_EXTERNALTRIG_T8_TRGO;
+	hadc1.Init.ExternalTrigConvEdge = ADC_EXTERNALTRIGCONVEDGE_RISING;
+	hadc1.Init.DMAContinuousRequests = ENABLE;
+	hadc1.Init.Overrun = ADC_OVR_DATA_PRESERVED;
+	hadc1.Init.OversamplingMode = DISABLE;
+	if (HAL_ADC_Init(&hadc1) != HAL_OK)
+	{
+		// Error_Handler();
+	}
+
+	/** Configure the ADC multi-mode
+	 */
+	multimode.Mode = ADC_MODE_INDEPENDENT;
+	if (HAL_ADCEx_MultiModeConfigChannel(&hadc1, &multimode) != HAL_OK)
+	{
+		// Error_Handler();
+	}
+
+	/** Configure Analog WatchDog 1
+	 */
+	AnalogWDGConfig.WatchdogNumber = ADC_ANALOGWATCHDOG_1;
+	AnalogWDGConfig.WatchdogMode = ADC_ANALOGWATCHDOG_SINGLE_REG;
+	AnalogWDGConfig.Channel = ADC_CHANNEL_1;
+	AnalogWDGConfig.ITMode = DISABLE;
+	AnalogWDGConfig.HighThreshold = 4095;
+	AnalogWDGConfig.LowThreshold = 0;
+	AnalogWDGConfig.FilteringConfig = ADC_AWD_FILTERING_NONE;
+	if (HAL_ADC_AnalogWDGConfig(&hadc1, &AnalogWDGConfig) != HAL_OK)
+	{
+		// Error_Handler();
+	}
+
+	/** Configure Regular Channel
+	 */
+	sConfig.Channel = ADC_CHANNEL_1;
+	sConfig.Rank = ADC_REGULAR_RANK_1;
+	sConfig.SamplingTime = ADC_SAMPLETIME_2CYCLES_5;
+	sConfig.SingleDiff = ADC_SINGLE_ENDED;
+	sConfig.OffsetNumber = ADC_OFFSET_NONE;
+	sConfig.Offset = 0;
+	if (HAL_ADC_ConfigChannel(&hadc1, &sConfig) != HAL_OK)
+	{
+		// Error_Handler();
+	}
+	/* USER CODE BEGIN ADC1_Init 2 */
+
+	/* USER CODE END ADC1_Init 2 */
+}
+
+static void MX_DAC1_Init(void)
+{
+
+	/* USER CODE BEGIN DAC1_Init 0 */
+
+	/* USER CODE END DAC1_Init 0 */
+
+	DAC_ChannelConfTypeDef sConfig = {0};
+
+	/* USER CODE BEGIN DAC1_Init 1 */
+
+	/* USER CODE END DAC1_Init 1 */
+
+	/** DAC Initialization
+	 */
+	hdac1.Instance = DAC1;
+	if (HAL_DAC_Init(&hdac1) != HAL_OK)
+	{
+		// Error_Handler();
+	}
+
+	/** DAC channel OUT1 config
+	 */
+	sConfig.DAC_HighFrequency = DAC_HIGH_FREQUENCY_INTERFACE_MODE_AUTOMATIC;
+	sConfig.DAC_DMADoubleDataMode = DISABLE;
+	sConfig.DAC_SignedFormat = DISABLE;
+	sConfig.DAC_SampleAndHold = DAC_SAMPLEANDHOLD_DISABLE;
+	sConfig.DAC_Trigger = DAC_TRIGGER_T3_TRGO;
+	sConfig.DAC_Trigger2 = DAC_TRIGGER_NONE;
+	sConfig.DAC_OutputBuffer = DAC_OUTPUTBUFFER_ENABLE;
+	sConfig.DAC_ConnectOnChipPeripheral = DAC_CHIPCONNECT_EXTERNAL;
+	sConfig.DAC_UserTrimming = DAC_TRIMMING_FACTORY;
+	if (HAL_DAC_ConfigChannel(&hdac1, &sConfig, DAC_CHANNEL_1) != HAL_OK)
+	{
+		// Error_Handler();
+	}
+	/* USER CODE BEGIN DAC1_Init 2 */
+
+	/* USER CODE END DAC1_Init 2 */
+}
+
+static void MX_TIM3_Init(void)
+{
+
+	/* USER CODE BEGIN TIM3_Init 0 */
+
+	/* USER CODE END TIM3_Init 0 */
+
+	TIM_ClockConfigTypeDef sClockSourceConfig = {0};
+	TIM_MasterConfigTypeDef sMasterConfig = {0};
+
+	/* USER CODE BEGIN TIM3_Init 1 */
+
+	/* USER CODE END TIM3_Init 1 */
+	htim3.Instance = TIM3;
+	htim3.Init.Prescaler = 0;
+	htim3.Init.CounterMode = TIM_COUNTERMODE_UP;
+	htim3.Init.Period = 11067;
+	htim3.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+	htim3.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_ENABLE;
+	if (HAL_TIM_Base_Init(&htim3) != HAL_OK)
+	{
+		// Error_Handler();
+	}
+	sClockSourceConfig.ClockSource = TIM_CLOCKSOURCE_INTERNAL;
+	if (HAL_TIM_ConfigClockSource(&htim3, &sClockSourceConfig) != HAL_OK)
+	{
+		// Error_Handler();
+	}
+	sMasterConfig.MasterOutputTrigger = TIM_TRGO_UPDATE;
+	sMasterConfig.MasterSlaveMode = TIM_MASTERSLAVEMODE_DISABLE;
+	if (HAL_TIMEx_MasterConfigSynchronization(&htim3, &sMasterConfig) != HAL_OK)
+	{
+		// Error_Handler();
+	}
+	/* USER CODE BEGIN TIM3_Init 2 */
+
+	/* USER CODE END TIM3_Init 2 */
+}
+
+static void MX_TIM8_Init(void)
+{
+
+	/* USER CODE BEGIN TIM8_Init 0 */
+
+	/* USER CODE END TIM8_Init 0 */
+
+	TIM_ClockConfigTypeDef sClockSourceConfig = {0};
+	TIM_MasterConfigTypeDef sMasterConfig = {0};
+
+	/* USER CODE BEGIN TIM8_Init 1 */
+
+	/* USER CODE END TIM8_Init 1 */
+	htim8.Instance = TIM8;
+	htim8.Init.Prescaler = 0;
+	htim8.Init.CounterMode = TIM_COUNTERMODE_UP;
+	htim8.Init.Period = 11067;
+	htim8.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+	htim8.Init.RepetitionCounter = 0;
+	htim8.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_ENABLE;
+	if (HAL_TIM_Base_Init(&htim8) != HAL_OK)
+	{
+		// Error_Handler();
+	}
+	sClockSourceConfig.ClockSource = TIM_CLOCKSOURCE_INTERNAL;
+	if (HAL_TIM_ConfigClockSource(&htim8, &sClockSourceConfig) != HAL_OK)
+	{
+		// Error_Handler();
+	}
+	sMasterConfig.MasterOutputTrigger = TIM_TRGO_UPDATE;
+	sMasterConfig.MasterOutputTrigger2 = TIM_TRGO2_RESET;
+	sMasterConfig.MasterSlaveMode = TIM_MASTERSLAVEMODE_DISABLE;
+	if (HAL_TIMEx_MasterConfigSynchronization(&htim8, &sMasterConfig) != HAL_OK)
+	{
+		// Error_Handler();
+	}
+	/* USER CODE BEGIN TIM8_Init 2 */
+
+	/* USER CODE END TIM8_Init 2 */
+}
+
+static void MX_DMA_Init(void)
+{
+
+	/* DMA controller clock enable */
+	__HAL_RCC_DMAMUX1_CLK_ENABLE();
+	__HAL_RCC_DMA1_CLK_ENABLE();
+
+	/* DMA interrupt init */
+	/* DMA1_Channel1_IRQn interrupt configuration */
+	HAL_NVIC_SetPriority(DMA1_Channel1_IRQn, 5, 0);
+	HAL_NVIC_EnableIRQ(DMA1_Channel1_IRQn);
+	/* DMA1_Channel2_IRQn interrupt configuration */
+	HAL_NVIC_SetPriority(DMA1_Channel2_IRQn, 5, 0);
+	HAL_NVIC_EnableIRQ(DMA1_Channel2_IRQn);
+}
+
+DMA_HandleTypeDef hdma_adc1;
+
+DMA_HandleTypeDef hdma_dac1_ch1;
+
+DMA_HandleTypeDef hdma_adc1;
+DMA_HandleTypeDef hdma_dac1_ch1;
+UART_HandleTypeDef hlpuart1;
+TIM_HandleTypeDef htim1;
+
+void HAL_MspInit(void)
+{
+	/* USER CODE BEGIN MspInit 0 */
+
+	/* USER CODE END MspInit 0 */
+
+	__HAL_RCC_SYSCFG_CLK_ENABLE();
+	__HAL_RCC_PWR_CLK_ENABLE();
+
+	/* System interrupt init*/
+	/* PendSV_IRQn interrupt configuration */
+	HAL_NVIC_SetPriority(PendSV_IRQn, 15, 0);
+
+	/** Disable the internal Pull-Up in Dead Battery pins of UCPD peripheral
+	 */
+	HAL_PWREx_DisableUCPDDeadBattery();
+
+	/* USER CODE BEGIN MspInit 1 */
+
+	/* USER CODE END MspInit 1 */
+}
+
+void HAL_ADC_MspInit(ADC_HandleTypeDef *hadc)
+{
+	GPIO_InitTypeDef GPIO_InitStruct = {0};
+	RCC_PeriphCLKInitTypeDef PeriphClkInit = {0};
+	if (hadc->Instance == ADC1)
+	{
+		/* USER CODE BEGIN ADC1_MspInit 0 */
+
+		/* USER CODE END ADC1_MspInit 0 */
+
+		/** Initializes the peripherals clocks
+		 */
+		PeriphClkInit.PeriphClockSelection = RCC_PERIPHCLK_ADC12;
+		PeriphClkInit.Adc12ClockSelection = RCC_ADC12CLKSOURCE_SYSCLK;
+		if (HAL_RCCEx_PeriphCLKConfig(&PeriphClkInit) != HAL_OK)
+		{
+			//   Error_Handler();
+		}
+
+		/* Peripheral clock enable */
+		__HAL_RCC_ADC12_CLK_ENABLE();
+
+		__HAL_RCC_GPIOA_CLK_ENABLE();
+		/**ADC1 GPIO Configuration
+		PA0     ------> ADC1_IN1
+		*/
+		GPIO_InitStruct.Pin = GPIO_PIN_0;
+		GPIO_InitStruct.Mode = GPIO_MODE_ANALOG;
+		GPIO_InitStruct.Pull = GPIO_NOPULL;
+		HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
+
+		/* ADC1 DMA Init */
+		/* ADC1 Init */
+		hdma_adc1.Instance = DMA1_Channel2;
+		hdma_adc1.Init.Request = DMA_REQUEST_ADC1;
+		hdma_adc1.Init.Direction = DMA_PERIPH_TO_MEMORY;
+		hdma_adc1.Init.PeriphInc = DMA_PINC_DISABLE;
+		hdma_adc1.Init.MemInc = DMA_MINC_ENABLE;
+		hdma_adc1.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+		hdma_adc1.Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+		hdma_adc1.Init.Mode = DMA_CIRCULAR;
+		hdma_adc1.Init.Priority = DMA_PRIORITY_LOW;
+		if (HAL_DMA_Init(&hdma_adc1) != HAL_OK)
+		{
+			//   Error_Handler();
+		}
+
+		__HAL_LINKDMA(hadc, DMA_Handle, hdma_adc1);
+
+		/* USER CODE BEGIN ADC1_MspInit 1 */
+
+		/* USER CODE END ADC1_MspInit 1 */
+	}
+}
+
+void HAL_ADC_MspDeInit(ADC_HandleTypeDef *hadc)
+{
+	if (hadc->Instance == ADC1)
+	{
+		/* USER CODE BEGIN ADC1_MspDeInit 0 */
+
+		/* USER CODE END ADC1_MspDeInit 0 */
+		/* Peripheral clock disable */
+		__HAL_RCC_ADC12_CLK_DISABLE();
+
+		/**ADC1 GPIO Configuration
+		PA0     ------> ADC1_IN1
+		*/
+		HAL_GPIO_DeInit(GPIOA, GPIO_PIN_0);
+
+		/* ADC1 DMA DeInit */
+		HAL_DMA_DeInit(hadc->DMA_Handle);
+		/* USER CODE BEGIN ADC1_MspDeInit 1 */
+
+		/* USER CODE END ADC1_MspDeInit 1 */
+	}
+}
+
+void HAL_DAC_MspInit(DAC_HandleTypeDef *hdac)
+{
+	GPIO_InitTypeDef GPIO_InitStruct = {0};
+	if (hdac->Instance == DAC1)
+	{
+		/* USER CODE BEGIN DAC1_MspInit 0 */
+
+		/* USER CODE END DAC1_MspInit 0 */
+		/* Peripheral clock enable */
+		__HAL_RCC_DAC1_CLK_ENABLE();
+
+		__HAL_RCC_GPIOA_CLK_ENABLE();
+		/**DAC1 GPIO Configuration
+		PA4     ------> DAC1_OUT1
+		*/
+		GPIO_InitStruct.Pin = GPIO_PIN_4;
+		GPIO_InitStruct.Mode = GPIO_MODE_ANALOG;
+		GPIO_InitStruct.Pull = GPIO_NOPULL;
+		HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
+
+		/* DAC1 DMA Init */
+		/* DAC1_CH1 Init */
+		hdma_dac1_ch1.Instance = DMA1_Channel1;
+		hdma_dac1_ch1.Init.Request = DMA_REQUEST_DAC1_CHANNEL1;
+		hdma_dac1_ch1.Init.Direction = DMA_MEMORY_TO_PERIPH;
+		hdma_dac1_ch1.Init.PeriphInc = DMA_PINC_DISABLE;
+		hdma_dac1_ch1.Init.MemInc = DMA_MINC_ENABLE;
+		hdma_dac1_ch1.Init.PeriphDataAlignment = DMA_PDATAALIGN_WORD;
+		hdma_dac1_ch1.Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+		hdma_dac1_ch1.Init.Mode = DMA_CIRCULAR;
+		hdma_dac1_ch1.Init.Priority = DMA_PRIORITY_LOW;
+		if (HAL_DMA_Init(&hdma_dac1_ch1) != HAL_OK)
+		{
+			//   Error_Handler();
+		}
+
+		__HAL_LINKDMA(hdac, DMA_Handle1, hdma_dac1_ch1);
+
+		/* USER CODE BEGIN DAC1_MspInit 1 */
+
+		/* USER CODE END DAC1_MspInit 1 */
+	}
+}
+
+void HAL_DAC_MspDeInit(DAC_HandleTypeDef *hdac)
+{
+	if (hdac->Instance == DAC1)
+	{
+		/* USER CODE BEGIN DAC1_MspDeInit 0 */
+
+		/* USER CODE END DAC1_MspDeInit 0 */
+		/* Peripheral clock disable */
+		__HAL_RCC_DAC1_CLK_DISABLE();
+
+		/**DAC1 GPIO Configuration
+		PA4     ------> DAC1_OUT1
+		*/
+		HAL_GPIO_DeInit(GPIOA, GPIO_PIN_4);
+
+		/* DAC1 DMA DeInit */
+		HAL_DMA_DeInit(hdac->DMA_Handle1);
+		/* USER CODE BEGIN DAC1_MspDeInit 1 */
+
+		/* USER CODE END DAC1_MspDeInit 1 */
+	}
+}
+
+void HAL_TIM_Base_MspInit(TIM_HandleTypeDef *htim_base)
+{
+	if (htim_base->Instance == TIM3)
+	{
+		/* USER CODE BEGIN TIM3_MspInit 0 */
+
+		/* USER CODE END TIM3_MspInit 0 */
+		/* Peripheral clock enable */
+		__HAL_RCC_TIM3_CLK_ENABLE();
+		/* USER CODE BEGIN TIM3_MspInit 1 */
+
+		/* USER CODE END TIM3_MspInit 1 */
+	}
+	else if (htim_base->Instance == TIM8)
+	{
+		/* USER CODE BEGIN TIM8_MspInit 0 */
+
+		/* USER CODE END TIM8_MspInit 0 */
+		/* Peripheral clock enable */
+		__HAL_RCC_TIM8_CLK_ENABLE();
+		/* USER CODE BEGIN TIM8_MspInit 1 */
+
+		/* USER CODE END TIM8_MspInit 1 */
+	}
+}
+
+void HAL_TIM_Base_MspDeInit(TIM_HandleTypeDef *htim_base)
+{
+	if (htim_base->Instance == TIM3)
+	{
+		/* USER CODE BEGIN TIM3_MspDeInit 0 */
+
+		/* USER CODE END TIM3_MspDeInit 0 */
+		/* Peripheral clock disable */
+		__HAL_RCC_TIM3_CLK_DISABLE();
+		/* USER CODE BEGIN TIM3_MspDeInit 1 */
+
+		/* USER CODE END TIM3_MspDeInit 1 */
+	}
+	else if (htim_base->Instance == TIM8)
+	{
+		/* USER CODE BEGIN TIM8_MspDeInit 0 */
+
+		/* USER CODE END TIM8_MspDeInit 0 */
+		/* Peripheral clock disable */
+		__HAL_RCC_TIM8_CLK_DISABLE();
+		/* USER CODE BEGIN TIM8_MspDeInit 1 */
+
+		/* USER CODE END TIM8_MspDeInit 1 */
+	}
+}
+
+void ADC1_2_IRQHandler(void)
+{
+	/* USER CODE BEGIN ADC1_2_IRQn 0 */
+
+	/* USER CODE END ADC1_2_IRQn 0 */
+	HAL_ADC_IRQHandler(&hadc1);
+	/* USER CODE BEGIN ADC1_2_IRQn 1 */
+
+	/* USER CODE END ADC1_2_IRQn 1 */
+}
+
+void DMA1_Channel1_IRQHandler(void)
+{
+	/* USER CODE BEGIN DMA1_Channel1_IRQn 0 */
+
+	/* USER CODE END DMA1_Channel1_IRQn 0 */
+	HAL_DMA_IRQHandler(&hdma_dac1_ch1);
+	/* USER CODE BEGIN DMA1_Channel1_IRQn 1 */
+
+	/* USER CODE END DMA1_Channel1_IRQn 1 */
+}
+
+void DMA1_Channel2_IRQHandler(void)
+{
+	/* USER CODE BEGIN DMA1_Channel2_IRQn 0 */
+
+	/* USER CODE END DMA1_Channel2_IRQn 0 */
+	HAL_DMA_IRQHandler(&hdma_adc1);
+	/* USER CODE BEGIN DMA1_Channel2_IRQn 1 */
+
+	/* USER CODE END DMA1_Channel2_IRQn 1 */
+}
+
+static acq_frame_cb_t acq_frame_cb;
+static uint32_t acq_frame_stamp;
+
+// Buffer que o DMA do ADC está preenchendo
+static uint16_t *acq_adc_buf;
+static size_t acq_adc_len;
+
+static acq_awd_cb_t acq_awd_cb;
+
+// Reaponta o canal circular do ADC para buf. Roda no fim do frame: a próxima
+// conversão só acontece um período do TIM8 depois, então nenhuma amostra se perde.
+static void acq_adc_retarget(uint16_t *buf)
+{
+	__HAL_DMA_DISABLE(&hdma_adc1);
+	hdma_adc1.Instance->CMAR = (uint32_t)buf;
+	hdma_adc1.Instance->CNDTR = acq_adc_len;
+	__HAL_DMA_ENABLE(&hdma_adc1);
+
+	acq_adc_buf = buf;
+}
+
+void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef *hadc)
+{
+	acq_frame_stamp = k_cycle_get_32();
+
+	uint16_t *next = acq_frame_cb(acq_adc_buf);
+
+	if (next != acq_adc_buf)
+	{
+		acq_adc_retarget(next);
+	}
+}
+
+void HAL_ADC_LevelOutOfWindowCallback(ADC_HandleTypeDef *hadc)
+{
+	acq_awd_cb_t cb = acq_awd_cb;
+
+	__HAL_ADC_DISABLE_IT(hadc, ADC_IT_AWD1);
+	acq_awd_cb = NULL;
+
+	if (cb != NULL)
+	{
+		cb();
+	}
+}
+
+// Frequência de update de um timer (TRGO): clock do barramento / ((PSC + 1) * (ARR + 1)).
+// Com os prescalers de APB em 1 o clock do timer é o próprio PCLK.
+static uint32_t tim_get_rate(const TIM_HandleTypeDef *htim, uint32_t pclk_hz)
+{
+	return pclk_hz / ((htim->Init.Prescaler + 1) * (htim->Init.Period + 1));
+}
+
+// Ajusta o TIM8 (gatilho do ADC) para a taxa mais próxima de fs_hz
+static void tim8_set_rate(uint32_t fs_hz)
+{
+	uint32_t ticks = HAL_RCC_GetPCLK2Freq() / fs_hz;
+	uint32_t prescaler = (ticks - 1) / 65536;
+
+	htim8.Init.Prescaler = prescaler;
+	htim8.Init.Period = (ticks / (prescaler + 1)) - 1;
+
+	__HAL_TIM_SET_PRESCALER(&htim8, htim8.Init.Prescaler);
+	__HAL_TIM_SET_AUTORELOAD(&htim8, htim8.Init.Period);
+	__HAL_TIM_SET_COUNTER(&htim8, 0);
+	// Carrega o prescaler agora (ele só é atualizado no evento de update)
+	HAL_TIM_GenerateEvent(&htim8, TIM_EVENTSOURCE_UPDATE);
+}
+
+void acq_init(acq_frame_cb_t frame_cb)
+{
+	acq_frame_cb = frame_cb;
+
+	MX_DMA_Init();
+	MX_ADC1_Init();
+	MX_DAC1_Init();
+	MX_TIM8_Init();
+	MX_TIM3_Init();
+
+	// Abaixo do DMA: um fim de frame pendente é atendido antes do watchdog
+	HAL_NVIC_SetPriority(ADC1_2_IRQn, 6, 0);
+	HAL_NVIC_EnableIRQ(ADC1_2_IRQn);
+
+	IRQ_CONNECT(DMA1_Channel1_IRQn, 5, DMA1_Channel1_IRQHandler, 0, 0);
+	IRQ_CONNECT(DMA1_Channel2_IRQn, 5, DMA1_Channel2_IRQHandler, 0, 0);
+	IRQ_CONNECT(ADC1_2_IRQn, 6, ADC1_2_IRQHandler, 0, 0);
+}
+
+void acq_adc_start(uint16_t *buf, size_t len)
+{
+	acq_adc_buf = buf;
+	acq_adc_len = len;
+
+	HAL_ADC_Start_DMA(&hadc1, (uint32_t *)buf, len);
+	HAL_TIM_Base_Start(&htim8);
+}
+
+void acq_adc_stop(void)
+{
+	HAL_TIM_Base_Stop(&htim8);
+	HAL_ADC_Stop_DMA(&hadc1);
+}
+
+size_t acq_adc_position(void)
+{
+	uint32_t tc;
+	size_t remaining;
+
+	// Relê se o frame terminar entre a leitura do contador e a da flag
+	do
+	{
+		tc = __HAL_DMA_GET_FLAG(&hdma_adc1, DMA_FLAG_TC2);
+		remaining = __HAL_DMA_GET_COUNTER(&hdma_adc1);
+	} while (tc != __HAL_DMA_GET_FLAG(&hdma_adc1, DMA_FLAG_TC2));
+
+	// Com a flag de fim de frame ainda pendente o contador já recarregou
+	return (acq_adc_len - remaining) + ((tc != 0) ? acq_adc_len : 0);
+}
+
+void acq_awd_start(uint16_t low, uint16_t high, acq_awd_cb_t cb)
+{
+	// Os limiares podem ser trocados com as conversões em andamento
+	acq_awd_cb = cb;
+	LL_ADC_ConfigAnalogWDThresholds(hadc1.Instance, LL_ADC_AWD1, high, low);
+	__HAL_ADC_CLEAR_FLAG(&hadc1, ADC_FLAG_AWD1);
+	__HAL_ADC_ENABLE_IT(&hadc1, ADC_IT_AWD1);
+}
+
+void acq_awd_stop(void)
+{
+	__HAL_ADC_DISABLE_IT(&hadc1, ADC_IT_AWD1);
+	acq_awd_cb = NULL;
+}
+
+uint32_t acq_adc_set_rate(uint32_t fs_hz)
+{
+	tim8_set_rate(fs_hz);
+
+	return acq_adc_get_rate();
+}
+
+uint32_t acq_adc_get_rate(void)
+{
+	return tim_get_rate(&htim8, HAL_RCC_GetPCLK2Freq());
+}
+
+void acq_dac_start(const uint16_t *wave, size_t len)
+{
+	HAL_TIM_Base_Stop(&htim3);
+	HAL_DAC_Stop_DMA(&hdac1, DAC_CHANNEL_1);
+	HAL_DAC_Start_DMA(&hdac1, DAC_CHANNEL_1, (uint32_t *)wave, len, DAC_ALIGN_12B_R);
+	HAL_TIM_Base_Start(&htim3);
+}
+
+uint32_t acq_dac_get_rate(void)
+{
+	return tim_get_rate(&htim3, HAL_RCC_GetPCLK1Freq());
+}
+
+uint32_t acq_frame_cycles(void)
+{
+	return acq_frame_stamp;
+}
@@ -0,0 +1,536 @@
+/*	Captura no domínio do tempo com gatilho (modo osciloscópio)
+ *
+ * 	O DMA do ADC escreve cada frame no próximo slot de um anel de frames
+ * 	brutos em vez de num buffer único, e a tarefa de FFT condiciona a partir do
+ * 	slot (dsp_process_frame não o reescreve). Os últimos frames ficam assim
+ * 	disponíveis como histórico pré-gatilho sem cópia nenhuma.
+ *
+ * 	O gatilho por nível ou borda usa o watchdog analógico do ADC: a comparação
+ * 	é feita pelo hardware e só gera interrupção no disparo. A borda é detectada
+ * 	em dois estágios: o sinal precisa passar pelo lado oposto do nível (com
+ * 	histerese) antes de o cruzamento valer. O gatilho externo é o botão sw0.
+ *
+ * 	Depois do disparo, quando o último frame da janela pós-gatilho fica
+ * 	completo, os slots da janela são retirados do rodízio e o DMA continua
+ * 	girando pelos outros, junto com a FFT. Nada é copiado: o shell lê a
+ * 	captura direto dos slots congelados até ela ser rearmada.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/sys/util.h>
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "acq.h"
+#include "capture.h"
+#include "dsp.h"
+
+#define CAP_SAMPLES CONFIG_APP_CAPTURE_BUFFER_SAMPLES
+#define CAP_MAX_SLOTS 32
+// A janela ocupa até (pre + post) / len + 2 frames e sempre sobram dois
+// livres: o que o DMA escreve e o que a tarefa de FFT lê
+#define CAP_MIN_SLOTS 4
+#define CAP_NO_FRAME UINT32_MAX
+
+#define CAP_ADC_MAX 4095
+#define CAP_VREF_MV 3300
+// Histerese do gatilho por borda, em códigos do ADC
+#define CAP_HYSTERESIS 16
+
+// Amostras lidas do anel por vez (com as interrupções bloqueadas)
+#define CAP_READ_CHUNK 16
+
+enum capture_trigger
+{
+	CAPTURE_TRIG_LEVEL,
+	CAPTURE_TRIG_RISING,
+	CAPTURE_TRIG_FALLING,
+	CAPTURE_TRIG_EXTERNAL,
+};
+
+enum cap_state
+{
+	CAP_OFF,	   // Anel não comporta o comprimento de frame atual
+	CAP_IDLE,	   // Anel girando, sem gatilho
+	CAP_FILLING,   // Armada, esperando o anel se renovar
+	CAP_ARMED,	   // Esperando o gatilho
+	CAP_TRIGGERED, // Esperando a janela pós-gatilho
+	CAP_FROZEN,	   // Janela congelada nos slots
+};
+
+static const char *const cap_state_names[] = {"indisponivel", "parada",	  "preenchendo",
+											  "armada",		  "disparada", "congelada"};
+static const char *const cap_trigger_names[] = {"level", "rise", "fall", "ext"};
+
+static uint16_t cap_arena[CAP_SAMPLES];
+
+// Anel: frame (contado desde capture_configure) contido em cada slot, slots
+// retirados do rodízio e slot que o DMA está escrevendo
+static size_t cap_len;
+static size_t cap_slots;
+static uint32_t cap_slot_frame[CAP_MAX_SLOTS];
+static uint32_t cap_held;
+static size_t cap_dma_slot;
+static uint32_t cap_frames;
+
+// Estado da captura. As posições são índices absolutos de amostra
+// (frame * cap_len + índice no frame); a janela é [cap_start, cap_end).
+static enum cap_state cap_state = CAP_OFF;
+static uint64_t cap_fill_end;
+static uint64_t cap_trig;
+static uint64_t cap_start;
+static uint64_t cap_end;
+static uint8_t cap_awd_stage;
+
+// Configuração, alterada pelo shell
+static enum capture_trigger cap_mode = CAPTURE_TRIG_RISING;
+static uint16_t cap_level = (CAP_ADC_MAX + 1) / 2;
+static uint32_t cap_pre = 256;
+static uint32_t cap_post = 256;
+
+static uint16_t *cap_slot_buf(size_t slot)
+{
+	return &cap_arena[slot * cap_len];
+}
+
+static size_t cap_max_window(void)
+{
+	return (cap_slots - (CAP_MIN_SLOTS - 1)) * cap_len;
+}
+
+static void cap_trigger(void)
+{
+	unsigned int key = irq_lock();
+
+	if (cap_state == CAP_ARMED)
+	{
+		// A amostra que disparou é a última convertida
+		size_t pos = MAX(acq_adc_position(), 1);
+
+		acq_awd_stop();
+		cap_trig = ((uint64_t)cap_frames * cap_len) + pos - 1;
+		cap_start = cap_trig - cap_pre;
+		cap_end = cap_trig + cap_post;
+		cap_state = CAP_TRIGGERED;
+	}
+
+	irq_unlock(key);
+}
+
+static void cap_awd_fired(void)
+{
+	if (cap_awd_stage == 1)
+	{
+		// O sinal passou pelo lado oposto do nível: agora vale o cruzamento
+		cap_awd_stage = 2;
+		if (cap_mode == CAPTURE_TRIG_RISING)
+		{
+			acq_awd_start(0, cap_level, cap_awd_fired);
+		}
+		else
+		{
+			acq_awd_start(cap_level, CAP_ADC_MAX, cap_awd_fired);
+		}
+		return;
+	}
+
+	cap_trigger();
+}
+
+// O watchdog dispara com a amostra fora de [low, high]
+static void cap_start_trigger(void)
+{
+	switch (cap_mode)
+	{
+	case CAPTURE_TRIG_LEVEL:
+		cap_awd_stage = 2;
+		acq_awd_start(0, cap_level, cap_awd_fired);
+		break;
+	case CAPTURE_TRIG_RISING:
+		cap_awd_stage = 1;
+		acq_awd_start(MAX(cap_level, CAP_HYSTERESIS) - CAP_HYSTERESIS, CAP_ADC_MAX, cap_awd_fired);
+		break;
+	case CAPTURE_TRIG_FALLING:
+		cap_awd_stage = 1;
+		acq_awd_start(0, MIN(cap_level + CAP_HYSTERESIS, CAP_ADC_MAX), cap_awd_fired);
+		break;
+	default:
+		break;
+	}
+}
+
+// Retira do rodízio os slots com frames da janela
+static void cap_freeze(void)
+{
+	uint32_t first = (uint32_t)(cap_start / cap_len);
+	uint32_t last = (uint32_t)((cap_end - 1) / cap_len);
+
+	for (size_t s = 0; s < cap_slots; s++)
+	{
+		if ((cap_slot_frame[s] >= first) && (cap_slot_frame[s] <= last))
+		{
+			cap_held |= BIT(s);
+		}
+	}
+
+	cap_state = CAP_FROZEN;
+}
+
+uint16_t *capture_configure(size_t len)
+{
+	unsigned int key = irq_lock();
+
+	acq_awd_stop();
+	cap_len = len;
+	cap_slots = MIN(CAP_SAMPLES / len, CAP_MAX_SLOTS);
+	cap_held = 0;
+	cap_dma_slot = 0;
+	cap_frames = 0;
+	for (size_t s = 0; s < CAP_MAX_SLOTS; s++)
+	{
+		cap_slot_frame[s] = CAP_NO_FRAME;
+	}
+	cap_state = (cap_slots >= CAP_MIN_SLOTS) ? CAP_IDLE : CAP_OFF;
+
+	irq_unlock(key);
+
+	return (cap_state == CAP_OFF) ? NULL : cap_arena;
+}
+
+uint16_t *capture_frame_done(uint16_t *done)
+{
+	if (cap_state == CAP_OFF)
+	{
+		return done;
+	}
+
+	cap_slot_frame[cap_dma_slot] = cap_frames++;
+
+	uint64_t written = (uint64_t)cap_frames * cap_len;
+
+	if ((cap_state == CAP_FILLING) && (written >= cap_fill_end))
+	{
+		cap_state = CAP_ARMED;
+		cap_start_trigger();
+	}
+	else if ((cap_state == CAP_TRIGGERED) && (written >= cap_end))
+	{
+		cap_freeze();
+	}
+
+	// Próximo slot fora da janela congelada, em rodízio
+	size_t s = cap_dma_slot;
+
+	do
+	{
+		s = (s + 1) % cap_slots;
+	} while ((cap_held & BIT(s)) != 0);
+
+	cap_dma_slot = s;
+	cap_slot_frame[s] = CAP_NO_FRAME;
+
+	return cap_slot_buf(s);
+}
+
+void capture_external_event(void)
+{
+	if (cap_mode == CAPTURE_TRIG_EXTERNAL)
+	{
+		cap_trigger();
+	}
+}
+
+// Copia amostras da janela congelada a partir de offset (0 = início da
+// janela). Retorna o número copiado ou -ENODATA se não há captura.
+static int cap_read(uint32_t offset, size_t count, uint16_t *out)
+{
+	unsigned int key = irq_lock();
+
+	if (cap_state != CAP_FROZEN)
+	{
+		irq_unlock(key);
+		return -ENODATA;
+	}
+
+	size_t window = cap_end - cap_start;
+	size_t n = (offset < window) ? MIN(count, window - offset) : 0;
+
+	for (size_t i = 0; i < n; i++)
+	{
+		uint64_t abs = cap_start + offset + i;
+		uint32_t frame = (uint32_t)(abs / cap_len);
+
+		for (size_t s = 0; s < cap_slots; s++)
+		{
+			if (cap_slot_frame[s] == frame)
+			{
+				out[i] = cap_slot_buf(s)[abs % cap_len];
+				break;
+			}
+		}
+	}
+
+	irq_unlock(key);
+
+	return (int)n;
+}
+
+// =============================== Shell ===============================
+
+static uint32_t cap_code_to_mv(uint16_t code)
+{
+	return ((uint32_t)code * CAP_VREF_MV) / (CAP_ADC_MAX + 1);
+}
+
+static int cmd_scope_info(const struct shell *sh, size_t argc, char **argv)
+{
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	unsigned int key = irq_lock();
+	enum cap_state state = cap_state;
+	size_t slots = cap_slots;
+	size_t len = cap_len;
+	uint64_t trig = cap_trig;
+	irq_unlock(key);
+
+	shell_print(sh, "Estado: %s; anel de %zu frames de %zu amostras (janela max %zu)", cap_state_names[state], slots,
+				len, (state == CAP_OFF) ? 0 : cap_max_window());
+	shell_print(sh, "Gatilho: %s em %u mV (codigo %u), janela %u pre + %u pos amostras, fs %u Hz",
+				cap_trigger_names[cap_mode], cap_code_to_mv(cap_level), cap_level, cap_pre, cap_post,
+				acq_adc_get_rate());
+	if (state == CAP_FROZEN)
+	{
+		shell_print(sh, "Captura: gatilho no frame %u, indice %u", (uint32_t)(trig / len), (uint32_t)(trig % len));
+	}
+
+	return 0;
+}
+
+static int cmd_scope_trig(const struct shell *sh, size_t argc, char **argv)
+{
+	int mode = -1;
+
+	for (size_t i = 0; i < ARRAY_SIZE(cap_trigger_names); i++)
+	{
+		if (strcmp(argv[1], cap_trigger_names[i]) == 0)
+		{
+			mode = i;
+		}
+	}
+
+	int mv = (argc > 2) ? atoi(argv[2]) : (int)cap_code_to_mv(cap_level);
+
+	if ((mode < 0) || (mv < 0) || (mv > CAP_VREF_MV))
+	{
+		shell_print(sh, "Uso: trig level|rise|fall|ext [mV, 0 a %d]", CAP_VREF_MV);
+		return -EINVAL;
+	}
+
+	// Só vale no próximo arm
+	cap_mode = mode;
+	cap_level = MIN(((uint32_t)mv * (CAP_ADC_MAX + 1)) / CAP_VREF_MV, CAP_ADC_MAX);
+
+	return 0;
+}
+
+static int cmd_scope_window(const struct shell *sh, size_t argc, char **argv)
+{
+	int pre = atoi(argv[1]);
+	int post = atoi(argv[2]);
+
+	if ((pre < 0) || (post <= 0))
+	{
+		shell_print(sh, "Uso: window pre pos (amostras, pos > 0)");
+		return -EINVAL;
+	}
+
+	cap_pre = pre;
+	cap_post = post;
+
+	return 0;
+}
+
+static int cmd_scope_arm(const struct shell *sh, size_t argc, char **argv)
+{
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	unsigned int key = irq_lock();
+
+	if (cap_state == CAP_OFF)
+	{
+		irq_unlock(key);
+		shell_print(sh, "Anel de %d amostras nao comporta %d frames de %zu", CAP_SAMPLES, CAP_MIN_SLOTS, dsp_len());
+		return -ENOTSUP;
+	}
+
+	if ((cap_pre + cap_post) > cap_max_window())
+	{
+		irq_unlock(key);
+		shell_print(sh, "Janela de %u amostras maior que o maximo (%zu)", cap_pre + cap_post, cap_max_window());
+		return -EINVAL;
+	}
+
+	// Os slots liberados voltam ao rodízio fora de ordem: o gatilho só é
+	// habilitado depois de o anel inteiro ser reescrito em sequência
+	acq_awd_stop();
+	cap_held = 0;
+	cap_fill_end = ((uint64_t)cap_frames + cap_slots) * cap_len;
+	cap_state = CAP_FILLING;
+
+	irq_unlock(key);
+
+	return 0;
+}
+
+static int cmd_scope_stop(const struct shell *sh, size_t argc, char **argv)
+{
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	unsigned int key = irq_lock();
+
+	if (cap_state != CAP_OFF)
+	{
+		acq_awd_stop();
+		cap_held = 0;
+		cap_state = CAP_IDLE;
+	}
+
+	irq_unlock(key);
+
+	return 0;
+}
+
+static int cmd_scope_force(const struct shell *sh, size_t argc, char **argv)
+{
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	if (cap_state != CAP_ARMED)
+	{
+		shell_print(sh, "Captura nao esta armada (%s)", cap_state_names[cap_state]);
+		return -EBUSY;
+	}
+
+	cap_trigger();
+
+	return 0;
+}
+
+// Argumentos opcionais [primeira quantidade], relativos ao início da janela
+// congelada; sem eles, a janela inteira. Também retorna quantas amostras da
+// janela antecedem o gatilho.
+static int cap_parse_range(const struct shell *sh, size_t argc, char **argv, uint32_t *first, uint32_t *count,
+						   uint32_t *pre)
+{
+	unsigned int key = irq_lock();
+	uint32_t window = (uint32_t)(cap_end - cap_start);
+
+	*pre = (uint32_t)(cap_trig - cap_start);
+	irq_unlock(key);
+
+	int f = (argc > 1) ? atoi(argv[1]) : 0;
+	int n = (argc > 2) ? atoi(argv[2]) : (int)window;
+
+	if ((f < 0) || (n < 0))
+	{
+		shell_print(sh, "Uso: [primeira quantidade]");
+		return -EINVAL;
+	}
+
+	*first = f;
+	*count = n;
+
+	return 0;
+}
+
+static int cmd_scope_dump(const struct shell *sh, size_t argc, char **argv)
+{
+	uint32_t first;
+	uint32_t count;
+	uint32_t pre;
+	uint16_t chunk[CAP_READ_CHUNK];
+
+	if (cap_parse_range(sh, argc, argv, &first, &count, &pre) != 0)
+	{
+		return -EINVAL;
+	}
+
+	shell_print(sh, "# amostra (relativa ao gatilho), codigo, mV");
+
+	for (uint32_t done = 0; done < count;)
+	{
+		int n = cap_read(first + done, MIN(count - done, CAP_READ_CHUNK), chunk);
+
+		if (n < 0)
+		{
+			shell_print(sh, "Nenhuma captura congelada");
+			return n;
+		}
+		if (n == 0)
+		{
+			break;
+		}
+
+		for (int i = 0; i < n; i++)
+		{
+			int rel = (int)(first + done + i) - (int)pre;
+
+			shell_print(sh, "%d,%u,%u", rel, chunk[i], cap_code_to_mv(chunk[i]));
+		}
+		done += n;
+	}
+
+	return 0;
+}
+
+// Códigos de 16 bits little endian, na ordem da janela
+static int cmd_scope_raw(const struct shell *sh, size_t argc, char **argv)
+{
+	uint32_t first;
+	uint32_t count;
+	uint32_t pre;
+	uint16_t chunk[CAP_READ_CHUNK];
+
+	if (cap_parse_range(sh, argc, argv, &first, &count, &pre) != 0)
+	{
+		return -EINVAL;
+	}
+
+	for (uint32_t done = 0; done < count;)
+	{
+		int n = cap_read(first + done, MIN(count - done, CAP_READ_CHUNK), chunk);
+
+		if (n < 0)
+		{
+			shell_print(sh, "Nenhuma captura congelada");
+			return n;
+		}
+		if (n == 0)
+		{
+			break;
+		}
+
+		shell_hexdump(sh, (const uint8_t *)chunk, n * sizeof(uint16_t));
+		done += n;
+	}
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(scope,
+							   SHELL_CMD(info, NULL, "Estado da captura", cmd_scope_info),
+							   SHELL_CMD_ARG(trig, NULL, "Gatilho: trig level|rise|fall|ext [mV]", cmd_scope_trig, 2, 1),
+							   SHELL_CMD_ARG(window, NULL, "Amostras antes e depois do gatilho: window pre pos", cmd_scope_window, 3, 0),
+							   SHELL_CMD(arm, NULL, "Arma a captura (libera a anterior)", cmd_scope_arm),
+							   SHELL_CMD(stop, NULL, "Desarma e libera a captura", cmd_scope_stop),
+							   SHELL_CMD(force, NULL, "Dispara a captura armada agora", cmd_scope_force),
+							   SHELL_CMD_ARG(dump, NULL, "Captura em CSV: [primeira quantidade]", cmd_scope_dump, 1, 2),
+							   SHELL_CMD_ARG(raw, NULL, "Captura em hex (u16 LE): [primeira quantidade]", cmd_scope_raw, 1, 2),
+							   SHELL_SUBCMD_SET_END);
+SHELL_CMD_REGISTER(scope, &scope, "Captura com gatilho (osciloscopio)", NULL);
@@ -0,0 +1,24 @@
+/*	Captura no domínio do tempo com gatilho (modo osciloscópio)
+ */
+
+#ifndef APP_SRC_CAPTURE_H_
+#define APP_SRC_CAPTURE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Reparte o anel em frames de len amostras e descarta a captura. Retorna o
+// buffer do primeiro frame, ou NULL se o anel não comporta frames desse
+// comprimento (a aquisição usa então o buffer do DSP e a captura fica
+// indisponível). Só pode ser chamada com a aquisição parada.
+uint16_t *capture_configure(size_t len);
+
+// Fim de frame (contexto de interrupção): registra o frame em done e retorna o
+// buffer em que o DMA deve escrever o próximo
+uint16_t *capture_frame_done(uint16_t *done);
+
+// Evento externo (botão sw0). Só dispara a captura com o gatilho externo
+// selecionado. Pode ser chamada de interrupção.
+void capture_external_event(void);
+
+#endif /* APP_SRC_CAPTURE_H_ */
@@ -0,0 +1,278 @@
+/*	Processamento de um frame do ADC: condicionamento, FFT e magnitude
+ *
+ * 	O condicionamento (custom_lib/sample_cond.h) lê o frame do ADC uma única
+ * 	vez, do buffer do DMA do DSP ou de um slot da captura, e trabalha num buffer
+ * 	próprio que nunca é destino do DMA: as amostras de 12 bits viram Q15
+ * 	centrado no meio da escala, passam pela correção de ganho e offset e pela
+ * 	remoção do nível DC, e só então são convertidas para float. As amostras em
+ * 	Q15 ficam disponíveis (dsp_samples) até o próximo frame.
+ *
+ * 	O módulo é protegido por um seqlock (seqlock.h): a tarefa de FFT o toma
+ * 	para reescrever o buffer ou reparti-lo em dsp_configure, e nunca espera
+ * 	pelos leitores.
+ *
+ * 	Os buffers vêm de arenas dimensionadas para CONFIG_APP_FFT_MAX_LEN e são
+ * 	repartidos em dsp_configure() para o comprimento escolhido em tempo de
+ * 	execução. Com CONFIG_APP_CCM_CODE este arquivo é realocado para a CCM SRAM
+ * 	(zephyr_code_relocate no CMakeLists.txt) e executa sem wait states.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/util.h>
+
+#include <errno.h>
+#include <string.h>
+
+#include <custom_lib/sample_cond.h>
+
+#include "arm_const_structs.h"
+
+#include "dsp.h"
+#include "seqlock.h"
+#include "trace.h"
+
+BUILD_ASSERT(IS_POWER_OF_TWO(DSP_MAX_LEN) && (DSP_MAX_LEN >= DSP_MIN_LEN) && (DSP_MAX_LEN <= 4096),
+			 "CONFIG_APP_FFT_MAX_LEN deve ser potência de 2 entre 64 e 4096");
+BUILD_ASSERT(IS_POWER_OF_TWO(CONFIG_APP_FFT_DEFAULT_LEN), "CONFIG_APP_FFT_DEFAULT_LEN deve ser potência de 2");
+
+// Arena dos buffers de trabalho: ReIm (2N floats) seguido do módulo (N/2 floats).
+// Global para aparecer no map file (verificado por scripts/check_section_placement.py)
+float dsp_arena[(2 * DSP_MAX_LEN) + (DSP_MAX_LEN / 2)] DSP_BUFFER_SECTION;
+
+// Arena do DMA do ADC, sempre na SRAM principal: a CCM fica fora da matriz
+// usada pelo DMA
+uint16_t dsp_adc_arena[DSP_MAX_LEN];
+
+// Amostras condicionadas em Q15. Sem a captura o DMA continua escrevendo o
+// buffer circular durante o processamento, então o condicionamento não pode
+// ser feito no lugar.
+int16_t dsp_q15[DSP_MAX_LEN] DSP_SAMPLE_BUFFER_SECTION;
+
+#if defined(CONFIG_APP_CCM_FFT_TABLES)
+// Cópia das tabelas da CMSIS-DSP. O comprimento das tabelas de bit reversal
+// cresce com N, então a do maior N serve para todos.
+#define DSP_BITREV_LEN_(n) ARMBITREVINDEXTABLE_##n##_TABLE_LENGTH
+#define DSP_BITREV_LEN(n) DSP_BITREV_LEN_(n)
+
+float32_t dsp_twiddle[2 * DSP_MAX_LEN] DSP_CCM_SECTION;
+uint16_t dsp_bitrev[DSP_BITREV_LEN(CONFIG_APP_FFT_MAX_LEN)] DSP_CCM_SECTION;
+static arm_cfft_instance_f32 dsp_cfft_ccm;
+
+#define DSP_CCM_TABLES_SIZE (sizeof(dsp_twiddle) + sizeof(dsp_bitrev))
+#else
+#define DSP_CCM_TABLES_SIZE 0
+#endif
+
+#if defined(CONFIG_APP_CCM)
+// Os dados na CCM têm que caber junto com o código realocado, que o linker
+// confere; sem esta verificação o estouro só aparece como erro de link
+#define DSP_CCM_DATA_SIZE                                                                    \
+	((IS_ENABLED(CONFIG_APP_CCM_DSP_BUFFERS) ? sizeof(dsp_arena) : 0) +                      \
+	 (IS_ENABLED(CONFIG_APP_CCM_SAMPLE_BUFFER) ? sizeof(dsp_q15) : 0) + DSP_CCM_TABLES_SIZE)
+
+BUILD_ASSERT(DSP_CCM_DATA_SIZE <= DT_REG_SIZE(DT_NODELABEL(ccm0)),
+			 "Os buffers e tabelas escolhidos não cabem na CCM: reduza CONFIG_APP_FFT_MAX_LEN ou "
+			 "desabilite alguma opção CONFIG_APP_CCM_*");
+#endif
+
+static size_t dsp_n;
+static float dsp_scale;
+static const arm_cfft_instance_f32 *dsp_cfft;
+static float *dsp_reim_buf;
+static float *dsp_mag_buf;
+
+static struct dsp_cycles dsp_cycles = {.min = UINT32_MAX};
+
+static atomic_t dsp_seq;
+static uint32_t dsp_frame;
+static bool dsp_mag_valid;
+
+#if defined(CONFIG_APP_DSP_DC_REMOVAL)
+static struct sample_cond_dc dsp_dc;
+#endif
+
+// Instâncias da CMSIS-DSP até o máximo configurado; as maiores nem são
+// referenciadas para não trazer as tabelas para a flash
+static const arm_cfft_instance_f32 *dsp_cfft_for_len(size_t len)
+{
+	switch (len)
+	{
+	case 64:
+		return &arm_cfft_sR_f32_len64;
+#if DSP_MAX_LEN >= 128
+	case 128:
+		return &arm_cfft_sR_f32_len128;
+#endif
+#if DSP_MAX_LEN >= 256
+	case 256:
+		return &arm_cfft_sR_f32_len256;
+#endif
+#if DSP_MAX_LEN >= 512
+	case 512:
+		return &arm_cfft_sR_f32_len512;
+#endif
+#if DSP_MAX_LEN >= 1024
+	case 1024:
+		return &arm_cfft_sR_f32_len1024;
+#endif
+#if DSP_MAX_LEN >= 2048
+	case 2048:
+		return &arm_cfft_sR_f32_len2048;
+#endif
+#if DSP_MAX_LEN >= 4096
+	case 4096:
+		return &arm_cfft_sR_f32_len4096;
+#endif
+	default:
+		return NULL;
+	}
+}
+
+int dsp_configure(size_t len)
+{
+	const arm_cfft_instance_f32 *cfft = dsp_cfft_for_len(len);
+
+	if (cfft == NULL)
+	{
+		return -EINVAL;
+	}
+
+#if defined(CONFIG_APP_CCM_FFT_TABLES)
+	memcpy(dsp_twiddle, cfft->pTwiddle, 2 * len * sizeof(float32_t));
+	memcpy(dsp_bitrev, cfft->pBitRevTable, cfft->bitRevLength * sizeof(uint16_t));
+
+	dsp_cfft_ccm = *cfft;
+	dsp_cfft_ccm.pTwiddle = dsp_twiddle;
+	dsp_cfft_ccm.pBitRevTable = dsp_bitrev;
+	cfft = &dsp_cfft_ccm;
+#endif
+
+	seqlock_write_begin(&dsp_seq);
+
+	dsp_cfft = cfft;
+	dsp_n = len;
+	dsp_scale = 2.0f / (float)len;
+	dsp_reim_buf = dsp_arena;
+	dsp_mag_buf = dsp_arena + (2 * len);
+
+	memset(dsp_mag_buf, 0, (len / 2) * sizeof(float));
+	dsp_mag_valid = false;
+#if defined(CONFIG_APP_DSP_DC_REMOVAL)
+	sample_cond_dc_init(&dsp_dc, CONFIG_APP_DSP_DC_SHIFT);
+#endif
+	dsp_cycles = (struct dsp_cycles){.min = UINT32_MAX};
+
+	seqlock_write_end(&dsp_seq);
+
+	return 0;
+}
+
+size_t dsp_len(void)
+{
+	return dsp_n;
+}
+
+uint16_t *dsp_adc_buffer(void)
+{
+	return dsp_adc_arena;
+}
+
+const int16_t *dsp_samples(void)
+{
+	return dsp_q15;
+}
+
+float *dsp_reim(void)
+{
+	return dsp_reim_buf;
+}
+
+float *dsp_mag(void)
+{
+	return dsp_mag_buf;
+}
+
+void dsp_process_frame(const uint16_t *adc)
+{
+	uint32_t start = k_cycle_get_32();
+	uint32_t frame = dsp_frame + 1;
+	int16_t *q15 = dsp_q15;
+	float *reim = dsp_reim_buf;
+
+	// Um par de eventos por kernel, dentro do par do estágio
+	APP_TRACE_BEGIN("dsp_cond", frame);
+	APP_TRACE_BEGIN("cond_u12_to_q15", frame);
+	sample_cond_u12_to_q15(adc, q15, dsp_n);
+	APP_TRACE_END("cond_u12_to_q15", frame);
+	if ((CONFIG_APP_ADC_GAIN_Q14 != SAMPLE_COND_GAIN_ONE) || (CONFIG_APP_ADC_OFFSET_Q15 != 0))
+	{
+		APP_TRACE_BEGIN("cond_gain_offset", frame);
+		sample_cond_gain_offset(q15, dsp_n, CONFIG_APP_ADC_GAIN_Q14, CONFIG_APP_ADC_OFFSET_Q15);
+		APP_TRACE_END("cond_gain_offset", frame);
+	}
+#if defined(CONFIG_APP_DSP_DC_REMOVAL)
+	APP_TRACE_BEGIN("cond_dc_remove", frame);
+	sample_cond_dc_remove(&dsp_dc, q15, dsp_n);
+	APP_TRACE_END("cond_dc_remove", frame);
+#endif
+	APP_TRACE_BEGIN("cond_q15_to_cf32", frame);
+	sample_cond_q15_to_cf32(q15, reim, dsp_n, DSP_Q15_VOLTS);
+	APP_TRACE_END("cond_q15_to_cf32", frame);
+	APP_TRACE_END("dsp_cond", frame);
+
+	APP_TRACE_BEGIN("dsp_cfft", frame);
+	arm_cfft_f32(dsp_cfft, reim, 0, 1);
+	APP_TRACE_END("dsp_cfft", frame);
+
+	// Só a metade até Nyquist é usada
+	APP_TRACE_BEGIN("dsp_mag", frame);
+	seqlock_write_begin(&dsp_seq);
+	arm_cmplx_mag_f32(reim, dsp_mag_buf, dsp_n / 2);
+	arm_scale_f32(dsp_mag_buf, dsp_scale, dsp_mag_buf, dsp_n / 2);
+	dsp_frame++;
+	dsp_mag_valid = true;
+	seqlock_write_end(&dsp_seq);
+	APP_TRACE_END("dsp_mag", frame);
+
+	uint32_t elapsed = k_cycle_get_32() - start;
+
+	dsp_cycles.last = elapsed;
+	dsp_cycles.min = MIN(dsp_cycles.min, elapsed);
+	dsp_cycles.max = MAX(dsp_cycles.max, elapsed);
+	dsp_cycles.frames++;
+}
+
+int dsp_spectrum_read(size_t first, size_t count, float *out, struct dsp_spectrum *info)
+{
+	atomic_val_t seq;
+	bool valid;
+	size_t n;
+
+	do
+	{
+		seq = seqlock_read_begin(&dsp_seq);
+
+		size_t bins = dsp_n / 2;
+
+		valid = dsp_mag_valid;
+		n = (valid && (first < bins)) ? MIN(count, bins - first) : 0;
+
+		info->frame = dsp_frame;
+		info->len = dsp_n;
+		if (n > 0)
+		{
+			memcpy(out, &dsp_mag_buf[first], n * sizeof(float));
+		}
+	} while (seqlock_read_retry(&dsp_seq, seq));
+
+	return valid ? (int)n : -ENODATA;
+}
+
+void dsp_get_cycles(struct dsp_cycles *cycles)
+{
+	unsigned int key = irq_lock();
+
+	*cycles = dsp_cycles;
+	irq_unlock(key);
+}
@@ -0,0 +1,90 @@
+/*	Processamento de um frame do ADC: condicionamento, FFT e magnitude
+ */
+
+#ifndef APP_SRC_DSP_H_
+#define APP_SRC_DSP_H_
+
+#include <zephyr/devicetree.h>
+#include <zephyr/linker/devicetree_regions.h>
+#include <zephyr/toolchain.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Limites do comprimento do frame (potências de 2)
+#define DSP_MIN_LEN 64
+#define DSP_MAX_LEN CONFIG_APP_FFT_MAX_LEN
+
+// Um passo de Q15 em volts: 3,3 V / 4096 por contagem do ADC, 16 passos por contagem
+#define DSP_Q15_VOLTS 0.00005035400390625f
+
+// Seções de dados na CCM SRAM (zero wait state, fora da matriz usada pelo DMA).
+// A região é NOLOAD: o conteúdo inicial não é zerado nem copiado.
+#define DSP_CCM_SECTION Z_GENERIC_SECTION(LINKER_DT_NODE_REGION_NAME(DT_NODELABEL(ccm0)))
+
+#if defined(CONFIG_APP_CCM_DSP_BUFFERS)
+#define DSP_BUFFER_SECTION DSP_CCM_SECTION
+#else
+#define DSP_BUFFER_SECTION
+#endif
+
+#if defined(CONFIG_APP_CCM_SAMPLE_BUFFER)
+#define DSP_SAMPLE_BUFFER_SECTION DSP_CCM_SECTION
+#else
+#define DSP_SAMPLE_BUFFER_SECTION
+#endif
+
+// Ciclos gastos em dsp_process_frame
+struct dsp_cycles
+{
+	uint32_t last;
+	uint32_t min;
+	uint32_t max;
+	uint32_t frames;
+};
+
+// Identificação de uma cópia do espectro
+struct dsp_spectrum
+{
+	uint32_t frame; // Número do frame (1 = primeiro após o boot)
+	uint32_t len;	// Comprimento da FFT do frame; há len / 2 bins
+};
+
+// Reparte as arenas para frames de "len" amostras e escolhe a instância da
+// FFT (copiando as tabelas para a CCM, se habilitado). Só pode ser chamada
+// com o DMA do ADC parado. Retorna -EINVAL se len não é suportado.
+int dsp_configure(size_t len);
+
+// Comprimento atual do frame
+size_t dsp_len(void);
+
+// Buffer do DMA do ADC (dsp_len() amostras)
+uint16_t *dsp_adc_buffer(void);
+
+// Amostras condicionadas (Q15) do último frame processado, dsp_len() amostras,
+// num buffer que nunca é destino do DMA. Só a tarefa de FFT pode ler, entre
+// dois dsp_process_frame().
+const int16_t *dsp_samples(void);
+
+// Saída complexa da FFT (re, im intercalados, 2 * dsp_len() floats)
+float *dsp_reim(void);
+
+// Módulo escalado para amplitude de pico (dsp_len() / 2 floats). Só a tarefa
+// de FFT pode ler diretamente; as outras usam dsp_spectrum_read().
+float *dsp_mag(void);
+
+// Copia os bins [first, first + count) do último módulo calculado, limitados
+// a len / 2, junto com o número do frame. Nunca bloqueia a tarefa de FFT (ver
+// seqlock.h). Só pode ser chamada de uma thread. Retorna o número de bins
+// copiados ou -ENODATA se nenhum frame foi processado desde o último
+// dsp_configure().
+int dsp_spectrum_read(size_t first, size_t count, float *out, struct dsp_spectrum *info);
+
+// Condiciona o frame do ADC em adc (dsp_len() amostras) para dsp_samples(),
+// calcula a FFT complexa e o módulo escalado. adc só é lido, uma vez, no
+// início do condicionamento.
+void dsp_process_frame(const uint16_t *adc);
+
+void dsp_get_cycles(struct dsp_cycles *cycles);
+
+#endif /* APP_SRC_DSP_H_ */
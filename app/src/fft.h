@@ -0,0 +1,27 @@
+/*	Tabelas do DAC e estatísticas da tarefa de FFT (main.c)
+ */
+
+#ifndef APP_SRC_FFT_H_
+#define APP_SRC_FFT_H_
+
+#include <stdint.h>
+
+// Tabelas do DAC: um período por tabela, independente do comprimento da FFT
+#define DAC_WAVE_LEN 256
+
+extern uint16_t sin_wave[DAC_WAVE_LEN];
+extern uint16_t sin_wave_3rd_harmonic[DAC_WAVE_LEN];
+
+// Latência fim a fim, do fim do frame no ADC até o espectro publicado no
+// zbus, em ciclos de k_cycle_get_32()
+struct fft_latency
+{
+	uint32_t frames;
+	uint32_t last;
+	uint32_t max;
+	uint64_t total;
+};
+
+void fft_get_latency(struct fft_latency *lat);
+
+#endif /* APP_SRC_FFT_H_ */
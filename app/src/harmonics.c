@@ -0,0 +1,159 @@
+/*	Estimador de frequência, amplitude e fase das harmônicas
+ *
+ * 	Para cada harmônica h procura o maior bin perto de h * f0 e interpola a
+ * 	posição do pico com o estimador de Jacobsen (com a correção de viés de
+ * 	Candan para janela retangular). A amplitude e a fase do bin são corrigidas
+ * 	pelo deslocamento fracionário usando o núcleo de Dirichlet. Perto do DC a
+ * 	imagem de frequência negativa vaza no bin e as estimativas pioram.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+
+#include <math.h>
+#include <string.h>
+
+#include "harmonics.h"
+
+#define HARM_COUNT CONFIG_APP_HARMONICS_COUNT
+
+#define HARM_PI 3.14159265358979f
+#define HARM_RAD_TO_DEG (180.0f / HARM_PI)
+
+static struct harmonic_estimate harm_result[HARM_COUNT];
+static uint32_t harm_frame;
+
+float fast_atan2f(float y, float x)
+{
+	float ax = fabsf(x);
+	float ay = fabsf(y);
+
+	if ((ax == 0.0f) && (ay == 0.0f))
+	{
+		return 0.0f;
+	}
+
+	// Reduz para |z| <= 1 e avalia atan(z) por um polinômio ímpar
+	float z = (ay <= ax) ? (ay / ax) : (ax / ay);
+	float z2 = z * z;
+	float a = z * (0.9998660f + z2 * (-0.3302995f + z2 * (0.1801410f + z2 * (-0.0851330f + z2 * 0.0208351f))));
+
+	if (ay > ax)
+	{
+		a = (HARM_PI / 2.0f) - a;
+	}
+	if (x < 0.0f)
+	{
+		a = HARM_PI - a;
+	}
+
+	return (y < 0.0f) ? -a : a;
+}
+
+static float harm_wrap_pi(float phase)
+{
+	phase = fmodf(phase, 2.0f * HARM_PI);
+	if (phase > HARM_PI)
+	{
+		phase -= 2.0f * HARM_PI;
+	}
+	else if (phase <= -HARM_PI)
+	{
+		phase += 2.0f * HARM_PI;
+	}
+
+	return phase;
+}
+
+static float harm_mag2(const float *reim, size_t k)
+{
+	return (reim[2 * k] * reim[2 * k]) + (reim[2 * k + 1] * reim[2 * k + 1]);
+}
+
+void harmonics_update(const float *reim, size_t n, float fs_hz, float f0_hz)
+{
+	struct harmonic_estimate est[HARM_COUNT] = {0};
+	float fund_phase = 0.0f;
+
+	// Correção de Candan do estimador de Jacobsen para janela retangular
+	float bias = tanf(HARM_PI / (float)n) / (HARM_PI / (float)n);
+
+	for (int h = 1; h <= HARM_COUNT; h++)
+	{
+		// Abaixo de um bin a fundamental não é resolvida; usa o bin 1
+		size_t expected = MAX((size_t)lroundf((float)h * f0_hz * (float)n / fs_hz), 1);
+
+		// Precisa de um vizinho de cada lado abaixo de Nyquist
+		if ((expected + 2) >= (n / 2))
+		{
+			break;
+		}
+
+		size_t k = expected;
+		if ((expected > 1) && (harm_mag2(reim, expected - 1) > harm_mag2(reim, k)))
+		{
+			k = expected - 1;
+		}
+		if (harm_mag2(reim, expected + 1) > harm_mag2(reim, k))
+		{
+			k = expected + 1;
+		}
+
+		const float *xm = &reim[2 * (k - 1)];
+		const float *x0 = &reim[2 * k];
+		const float *xp = &reim[2 * (k + 1)];
+
+		// delta = Re{(X[k-1] - X[k+1]) / (2X[k] - X[k-1] - X[k+1])}
+		float num_re = xm[0] - xp[0];
+		float num_im = xm[1] - xp[1];
+		float den_re = (2.0f * x0[0]) - xm[0] - xp[0];
+		float den_im = (2.0f * x0[1]) - xm[1] - xp[1];
+		float den = (den_re * den_re) + (den_im * den_im);
+		float delta = 0.0f;
+
+		if (den > 0.0f)
+		{
+			delta = bias * ((num_re * den_re) + (num_im * den_im)) / den;
+			delta = CLAMP(delta, -0.5f, 0.5f);
+		}
+
+		// |X[k]| * 2 / N, corrigido pela perda do sinc no deslocamento delta
+		float amplitude = sqrtf(harm_mag2(reim, k)) * 2.0f / (float)n;
+		if (delta != 0.0f)
+		{
+			amplitude *= (HARM_PI * delta) / sinf(HARM_PI * delta);
+		}
+
+		// Fase do tom no início do frame: remove a fase linear do núcleo de Dirichlet
+		float phase = fast_atan2f(x0[1], x0[0]) - (HARM_PI * delta * (float)(n - 1) / (float)n);
+
+		if (h == 1)
+		{
+			fund_phase = phase;
+		}
+
+		struct harmonic_estimate *e = &est[h - 1];
+
+		e->bin = (float)k + delta;
+		e->freq_hz = e->bin * fs_hz / (float)n;
+		e->amplitude = amplitude;
+		e->phase_deg = harm_wrap_pi(phase - ((float)h * fund_phase)) * HARM_RAD_TO_DEG;
+	}
+
+	unsigned int key = irq_lock();
+
+	memcpy(harm_result, est, sizeof(harm_result));
+	harm_frame++;
+	irq_unlock(key);
+}
+
+uint32_t harmonics_get(struct harmonic_estimate *out)
+{
+	unsigned int key = irq_lock();
+
+	memcpy(out, harm_result, sizeof(harm_result));
+	uint32_t frame = harm_frame;
+	irq_unlock(key);
+
+	return frame;
+}
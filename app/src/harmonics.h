@@ -0,0 +1,30 @@
+/*	Estimador de frequência, amplitude e fase das harmônicas
+ */
+
+#ifndef APP_SRC_HARMONICS_H_
+#define APP_SRC_HARMONICS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct harmonic_estimate
+{
+	float bin;		 // Posição interpolada do pico, em bins
+	float freq_hz;	 // Frequência interpolada
+	float amplitude; // Amplitude de pico corrigida pelo deslocamento fracionário
+	float phase_deg; // Fase relativa à fundamental (phi_h - h * phi_1), em graus
+};
+
+// Aproximação de atan2 com erro máximo de 1,2e-5 rad (polinômio de grau 9)
+float fast_atan2f(float y, float x);
+
+// Estima as harmônicas a partir da saída complexa da FFT (re, im intercalados).
+// n é o comprimento da FFT, fs_hz a taxa de amostragem e f0_hz a frequência
+// esperada da fundamental (a harmônica h é procurada a um bin de h * f0_hz).
+void harmonics_update(const float *reim, size_t n, float fs_hz, float f0_hz);
+
+// Copia as últimas estimativas (CONFIG_APP_HARMONICS_COUNT elementos, a
+// fundamental primeiro). Retorna o número do frame estimado.
+uint32_t harmonics_get(struct harmonic_estimate *out);
+
+#endif /* APP_SRC_HARMONICS_H_ */
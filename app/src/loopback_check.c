@@ -0,0 +1,251 @@
+/*	Auto-teste do laço DAC -> ADC
+ *
+ * 	Depois de o pipeline estabilizar, compara as harmônicas estimadas com os
+ * 	valores de referência calculados pela DFT da tabela que o DAC toca no boot
+ * 	(sin_wave_3rd_harmonic) e confere a vazão numa janela contra fs / len e a
+ * 	latência média, do fim do frame no ADC até a publicação no zbus, contra o
+ * 	período de um frame. No native_sim a latência é medida em tempo simulado:
+ * 	o processamento não consome nenhum, então ela mede só a espera pela tarefa
+ * 	de FFT e pelo zbus. Os ciclos do DSP só são impressos na placa.
+ * 	Com o zoom habilitado, centra o zoom na 3ª harmônica e confere o pico
+ * 	perto do centro: frequência a menos de um bin da esperada e amplitude
+ * 	próxima à da harmônica na tabela.
+ * 	O resultado é impresso no console, onde é conferido pelo Twister
+ * 	(cenários app.loopback* do sample.yaml).
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/sys/util.h>
+
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "acq.h"
+#include "dsp.h"
+#include "fft.h"
+#include "harmonics.h"
+#if defined(CONFIG_APP_ZOOM)
+#include "zoom.h"
+#endif
+
+#define LOOPBACK_PI 3.14159265358979f
+#define LOOPBACK_LSB_V 0.0008056640625f
+
+// Harmônicas abaixo dessa fração da fundamental só têm a amplitude conferida
+#define LOOPBACK_MIN_REL_AMPLITUDE 0.05f
+#define LOOPBACK_BIN_TOL 0.05f
+#define LOOPBACK_PHASE_TOL_DEG 2.0f
+// A janela pode começar e terminar no meio de um frame
+#define LOOPBACK_FPS_TOL_PERMILLE 10
+// Um span de fs / 64 leva à decimação máxima padrão (16). A faixa publicada
+// tem fs / (2 * D) de largura, mais que o span: com fs = 15,36 kHz ela vai de
+// -60 Hz a 420 Hz em torno dos 180 Hz da 3ª harmônica e contém a fundamental
+// e a sua imagem. Por isso o pico só é procurado a poucos bins do centro. O
+// primeiro espectro inclui o transitório do filtro: a busca é feita no
+// segundo.
+#define LOOPBACK_ZOOM_SPAN_DIV 64
+#define LOOPBACK_ZOOM_SEARCH_BINS 4
+// Perda da janela de Hann entre dois bins: até 15 %
+#define LOOPBACK_ZOOM_AMP_TOL 0.2f
+#define LOOPBACK_ZOOM_SPECTRA 2
+#define LOOPBACK_ZOOM_POLL_MS 100
+#define LOOPBACK_ZOOM_TIMEOUT_MS 10000
+
+#if defined(CONFIG_APP_ACQ_SIM)
+#define LOOPBACK_GAIN (CONFIG_APP_ACQ_SIM_GAIN_PERMILLE / 1000.0f)
+#else
+#define LOOPBACK_GAIN 1.0f
+#endif
+
+static float loopback_wrap_deg(float deg)
+{
+	deg = fmodf(deg, 360.0f);
+	if (deg > 180.0f)
+	{
+		deg -= 360.0f;
+	}
+	else if (deg <= -180.0f)
+	{
+		deg += 360.0f;
+	}
+
+	return deg;
+}
+
+// Amplitude de pico (V) e fase (rad) da harmônica h da tabela
+static void loopback_reference(const uint16_t *wave, int h, float *amplitude, float *phase)
+{
+	float re = 0.0f;
+	float im = 0.0f;
+
+	for (int i = 0; i < DAC_WAVE_LEN; i++)
+	{
+		float a = 2.0f * LOOPBACK_PI * (float)((h * i) % DAC_WAVE_LEN) / DAC_WAVE_LEN;
+
+		re += (float)wave[i] * cosf(a);
+		im -= (float)wave[i] * sinf(a);
+	}
+
+	*amplitude = sqrtf((re * re) + (im * im)) * 2.0f / DAC_WAVE_LEN * LOOPBACK_LSB_V * LOOPBACK_GAIN;
+	*phase = atan2f(im, re);
+}
+
+static bool loopback_check_harmonics(void)
+{
+	struct harmonic_estimate est[CONFIG_APP_HARMONICS_COUNT];
+	float ref_amplitude[CONFIG_APP_HARMONICS_COUNT];
+	float ref_phase[CONFIG_APP_HARMONICS_COUNT];
+	bool ok = true;
+
+	harmonics_get(est);
+
+	for (int h = 0; h < CONFIG_APP_HARMONICS_COUNT; h++)
+	{
+		loopback_reference(sin_wave_3rd_harmonic, h + 1, &ref_amplitude[h], &ref_phase[h]);
+	}
+
+	float fund = ref_amplitude[0];
+	float amplitude_tol = fund * CONFIG_APP_LOOPBACK_CHECK_TOL_PERMILLE / 1000.0f;
+	float bin_per_harm = (float)dsp_len() * ((float)acq_dac_get_rate() / DAC_WAVE_LEN) / (float)acq_adc_get_rate();
+
+	for (int h = 0; h < CONFIG_APP_HARMONICS_COUNT; h++)
+	{
+		float bin = bin_per_harm * (float)(h + 1);
+		float phase = loopback_wrap_deg((ref_phase[h] - ((float)(h + 1) * ref_phase[0])) * (180.0f / LOOPBACK_PI));
+		bool h_ok = fabsf(est[h].amplitude - ref_amplitude[h]) <= amplitude_tol;
+
+		if (ref_amplitude[h] >= (LOOPBACK_MIN_REL_AMPLITUDE * fund))
+		{
+			h_ok = h_ok && (fabsf(est[h].bin - bin) <= LOOPBACK_BIN_TOL);
+			h_ok = h_ok && (fabsf(loopback_wrap_deg(est[h].phase_deg - phase)) <= LOOPBACK_PHASE_TOL_DEG);
+		}
+
+		printk("loopback: h%d amp %f V (esperado %f) bin %f (esperado %f) fase %f (esperado %f) %s\n", h + 1,
+			   (double)est[h].amplitude, (double)ref_amplitude[h], (double)est[h].bin, (double)bin,
+			   (double)est[h].phase_deg, (double)phase, h_ok ? "ok" : "FALHA");
+
+		ok = ok && h_ok;
+	}
+
+	return ok;
+}
+
+// Confere a vazão contra fs / len e a latência média contra o período de um
+// frame, e imprime os ciclos do DSP
+static bool loopback_check_throughput(void)
+{
+	struct fft_latency start;
+	struct fft_latency end;
+	struct dsp_cycles cycles;
+
+	fft_get_latency(&start);
+	k_msleep(CONFIG_APP_LOOPBACK_CHECK_WINDOW_MS);
+	fft_get_latency(&end);
+	dsp_get_cycles(&cycles);
+
+	uint32_t frames = end.frames - start.frames;
+	uint32_t fps_milli = (uint32_t)((1000000ULL * frames) / CONFIG_APP_LOOPBACK_CHECK_WINDOW_MS);
+	uint32_t expected_milli = (uint32_t)((1000ULL * acq_adc_get_rate()) / dsp_len());
+	uint32_t mean = (frames > 0) ? (uint32_t)((end.total - start.total) / frames) : 0;
+	uint32_t period_us = (uint32_t)((1000000ULL * dsp_len()) / acq_adc_get_rate());
+	bool ok = ((uint64_t)abs((int32_t)(fps_milli - expected_milli)) * 1000) <=
+			  ((uint64_t)expected_milli * LOOPBACK_FPS_TOL_PERMILLE);
+	bool lat_ok = k_cyc_to_us_floor32(mean) < period_us;
+
+	printk("loopback: vazao %u.%03u frames/s (esperado %u.%03u), %u amostras/s (frame de %u, fs %u Hz) %s\n",
+		   fps_milli / 1000, fps_milli % 1000, expected_milli / 1000, expected_milli % 1000,
+		   (uint32_t)(((uint64_t)fps_milli * dsp_len()) / 1000), (uint32_t)dsp_len(), acq_adc_get_rate(),
+		   ok ? "ok" : "FALHA");
+
+	// O máximo é desde o boot; só a média é da janela
+	printk("loopback: latencia media %u us, max %u us (frame de %u us%s) %s\n", k_cyc_to_us_floor32(mean),
+		   k_cyc_to_us_floor32(end.max), period_us, IS_ENABLED(CONFIG_ARCH_POSIX) ? ", tempo simulado" : "",
+		   lat_ok ? "ok" : "FALHA");
+
+	if (IS_ENABLED(CONFIG_ARCH_POSIX))
+	{
+		// k_cycle_get_32() conta tempo simulado, e o código não consome nenhum
+		printk("loopback: ciclos do dsp nao medidos (o processamento nao consome tempo simulado)\n");
+	}
+	else
+	{
+		printk("loopback: dsp %u ciclos por frame (min %u, max %u, %u frames)\n", cycles.last, cycles.min, cycles.max,
+			   cycles.frames);
+	}
+
+	return ok && lat_ok;
+}
+
+#if defined(CONFIG_APP_ZOOM)
+// Centra o zoom na 3ª harmônica e confere a frequência e a amplitude do pico
+// perto do centro
+static bool loopback_check_zoom(void)
+{
+	static float mag[CONFIG_APP_ZOOM_LEN / 2];
+	float expected = 3.0f * (float)acq_dac_get_rate() / DAC_WAVE_LEN;
+	struct zoom_spectrum info = {0};
+	int n = -ENODATA;
+
+	zoom_set((uint32_t)lroundf(expected), acq_adc_get_rate() / LOOPBACK_ZOOM_SPAN_DIV);
+
+	for (int waited = 0; waited < LOOPBACK_ZOOM_TIMEOUT_MS; waited += LOOPBACK_ZOOM_POLL_MS)
+	{
+		k_msleep(LOOPBACK_ZOOM_POLL_MS);
+		n = zoom_read(0, ARRAY_SIZE(mag), mag, &info);
+		if ((n > 0) && (info.count >= LOOPBACK_ZOOM_SPECTRA))
+		{
+			break;
+		}
+	}
+	zoom_set(0, 0);
+
+	if ((n <= 0) || (info.count < LOOPBACK_ZOOM_SPECTRA))
+	{
+		printk("loopback: zoom sem espectro em %d ms FALHA\n", LOOPBACK_ZOOM_TIMEOUT_MS);
+		return false;
+	}
+
+	float ref_amplitude;
+	float ref_phase;
+	int center = (int)lroundf((info.center_hz - info.first_hz) / info.bin_hz);
+	int first = MAX(center - LOOPBACK_ZOOM_SEARCH_BINS, 0);
+	int last = MIN(center + LOOPBACK_ZOOM_SEARCH_BINS, n - 1);
+	int peak = first;
+
+	loopback_reference(sin_wave_3rd_harmonic, 3, &ref_amplitude, &ref_phase);
+
+	for (int k = first + 1; k <= last; k++)
+	{
+		if (mag[k] > mag[peak])
+		{
+			peak = k;
+		}
+	}
+
+	float peak_hz = info.first_hz + ((float)peak * info.bin_hz);
+	bool ok = (fabsf(peak_hz - expected) <= info.bin_hz) &&
+			  (fabsf(mag[peak] - ref_amplitude) <= (LOOPBACK_ZOOM_AMP_TOL * ref_amplitude));
+
+	printk("loopback: zoom pico %f Hz, %f V (esperado %f Hz, %f V; resolucao %f Hz, decimacao %u) %s\n",
+		   (double)peak_hz, (double)mag[peak], (double)expected, (double)ref_amplitude, (double)info.bin_hz, info.decim,
+		   ok ? "ok" : "FALHA");
+
+	return ok;
+}
+#endif
+
+static void loopback_check_task(void)
+{
+	bool ok = loopback_check_harmonics();
+
+	ok = loopback_check_throughput() && ok;
+#if defined(CONFIG_APP_ZOOM)
+	ok = loopback_check_zoom() && ok;
+#endif
+
+	printk("loopback: resultado %s\n", ok ? "OK" : "FALHA");
+}
+
+K_THREAD_DEFINE(loopback_check_th, 2048, loopback_check_task, NULL, NULL, NULL, 8, 0, CONFIG_APP_LOOPBACK_CHECK_DELAY_MS);
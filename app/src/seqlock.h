@@ -0,0 +1,67 @@
+/*	Seqlock de um escritor e vários leitores
+ *
+ * 	O contador fica ímpar enquanto o escritor altera os dados protegidos. O
+ * 	escritor nunca espera; os leitores copiam os dados e repetem a cópia se o
+ * 	contador mudou no meio:
+ *
+ * 		atomic_val_t seq;
+ *
+ * 		do
+ * 		{
+ * 			seq = seqlock_read_begin(&lock);
+ * 			// copia os dados
+ * 		} while (seqlock_read_retry(&lock, seq));
+ *
+ * 	Um leitor que encontra a escrita em andamento dorme um tick antes de
+ * 	repetir: k_yield() não cederia a CPU ao escritor se o leitor tivesse
+ * 	prioridade maior. Os leitores devem ter prioridade menor que o escritor;
+ * 	com prioridade maior cada colisão custa um tick.
+ */
+
+#ifndef APP_SRC_SEQLOCK_H_
+#define APP_SRC_SEQLOCK_H_
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+
+#include <stdbool.h>
+
+static inline void seqlock_write_begin(atomic_t *seq)
+{
+	atomic_inc(seq);
+}
+
+static inline void seqlock_write_end(atomic_t *seq)
+{
+	atomic_inc(seq);
+}
+
+// Espera o contador ficar par e o retorna
+static inline atomic_val_t seqlock_read_begin(const atomic_t *seq)
+{
+	atomic_val_t start = atomic_get(seq);
+
+	while ((start & 1) != 0)
+	{
+		k_sleep(K_TICKS(1));
+		start = atomic_get(seq);
+	}
+
+	return start;
+}
+
+// Retorna true se houve escrita desde seqlock_read_begin(): a cópia deve ser
+// descartada e refeita
+static inline bool seqlock_read_retry(const atomic_t *seq, atomic_val_t start)
+{
+	if (atomic_get(seq) == start)
+	{
+		return false;
+	}
+
+	k_sleep(K_TICKS(1));
+
+	return true;
+}
+
+#endif /* APP_SRC_SEQLOCK_H_ */
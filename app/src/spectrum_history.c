@@ -0,0 +1,232 @@
+/*	Histórico compacto de espectros (waterfall)
+ *
+ * 	A tarefa de FFT acumula o máximo de cada bin durante
+ * 	CONFIG_APP_SPECTRUM_HISTORY_DECIMATION frames e grava o resultado como uma
+ * 	linha de 8 bits por bin num anel. Cada posição do anel tem o seu seqlock
+ * 	(seqlock.h), então a tarefa de FFT nunca espera pelos leitores.
+ * 	Cada linha guarda a largura dos bins com que foi acumulada: depois de um
+ * 	dac len ou dac rate, as linhas antigas continuam legíveis com a sua.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/util.h>
+
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "seqlock.h"
+#include "spectrum_history.h"
+
+#define HIST_DEPTH CONFIG_APP_SPECTRUM_HISTORY_DEPTH
+#define HIST_BINS CONFIG_APP_SPECTRUM_HISTORY_BINS
+#define HIST_FIRST_BIN CONFIG_APP_SPECTRUM_HISTORY_FIRST_BIN
+
+// Passos de código por década: 0,5 dB por passo => 40 passos por década
+#define HIST_STEPS_PER_DECADE 40.0f
+
+BUILD_ASSERT(HIST_FIRST_BIN + HIST_BINS <= (CONFIG_APP_FFT_MAX_LEN / 2), "Janela do histórico fora do espectro útil");
+
+struct hist_slot
+{
+	atomic_t seq;
+	struct spectrum_history_row row;
+};
+
+static struct hist_slot hist_ring[HIST_DEPTH];
+static atomic_t hist_written;
+
+// Estado do escritor, acessado apenas pela tarefa de FFT
+static float hist_acc[HIST_BINS];
+static uint32_t hist_acc_frames;
+static float hist_acc_bin_hz;
+static uint32_t hist_frame;
+
+static uint8_t hist_encode(float value, float peak)
+{
+	if (value <= 0.0f)
+	{
+		return 0;
+	}
+
+	long code = 255 + lroundf(HIST_STEPS_PER_DECADE * log10f(value / peak));
+
+	return (uint8_t)CLAMP(code, 1, 255);
+}
+
+void spectrum_history_add(const float *mag, size_t len, float bin_hz)
+{
+	hist_frame++;
+
+	if (bin_hz != hist_acc_bin_hz)
+	{
+		memset(hist_acc, 0, sizeof(hist_acc));
+		hist_acc_frames = 0;
+		hist_acc_bin_hz = bin_hz;
+	}
+
+	for (int i = 0; i < HIST_BINS; i++)
+	{
+		size_t bin = HIST_FIRST_BIN + i;
+		float value = (bin < len) ? mag[bin] : 0.0f;
+
+		if (value > hist_acc[i])
+		{
+			hist_acc[i] = value;
+		}
+	}
+
+	if (++hist_acc_frames < CONFIG_APP_SPECTRUM_HISTORY_DECIMATION)
+	{
+		return;
+	}
+	hist_acc_frames = 0;
+
+	float peak = 0.0f;
+	for (int i = 0; i < HIST_BINS; i++)
+	{
+		peak = MAX(peak, hist_acc[i]);
+	}
+
+	atomic_val_t n = atomic_get(&hist_written);
+	struct hist_slot *slot = &hist_ring[(uint32_t)n % HIST_DEPTH];
+
+	seqlock_write_begin(&slot->seq);
+
+	slot->row.frame = hist_frame;
+	slot->row.bin_hz = hist_acc_bin_hz;
+	slot->row.peak = peak;
+	for (int i = 0; i < HIST_BINS; i++)
+	{
+		slot->row.bins[i] = hist_encode(hist_acc[i], peak);
+		hist_acc[i] = 0.0f;
+	}
+
+	seqlock_write_end(&slot->seq);
+	atomic_set(&hist_written, n + 1);
+}
+
+uint32_t spectrum_history_count(void)
+{
+	return MIN((uint32_t)atomic_get(&hist_written), HIST_DEPTH);
+}
+
+int spectrum_history_read(uint32_t age, struct spectrum_history_row *row)
+{
+	while (1)
+	{
+		atomic_val_t n = atomic_get(&hist_written);
+
+		if (age >= MIN((uint32_t)n, HIST_DEPTH))
+		{
+			return -ENOENT;
+		}
+
+		struct hist_slot *slot = &hist_ring[((uint32_t)n - 1 - age) % HIST_DEPTH];
+		atomic_val_t seq = seqlock_read_begin(&slot->seq);
+
+		memcpy(row, &slot->row, sizeof(*row));
+
+		// Uma linha nova desloca as idades: repete também nesse caso
+		if (!seqlock_read_retry(&slot->seq, seq) && (atomic_get(&hist_written) == n))
+		{
+			return 0;
+		}
+	}
+}
+
+float spectrum_history_decode(const struct spectrum_history_row *row, size_t bin)
+{
+	if ((bin >= HIST_BINS) || (row->bins[bin] == 0))
+	{
+		return 0.0f;
+	}
+
+	return row->peak * powf(10.0f, ((float)row->bins[bin] - 255.0f) / HIST_STEPS_PER_DECADE);
+}
+
+// =============================== Shell ===============================
+
+static int cmd_hist_info(const struct shell *sh, size_t argc, char **argv)
+{
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	shell_print(sh, "Linhas: %u de %d, %d frames por linha", spectrum_history_count(), HIST_DEPTH,
+				CONFIG_APP_SPECTRUM_HISTORY_DECIMATION);
+	shell_print(sh, "Bins: %d a %d, %zu bytes por linha", HIST_FIRST_BIN, HIST_FIRST_BIN + HIST_BINS - 1,
+				sizeof(struct spectrum_history_row));
+
+	return 0;
+}
+
+static int cmd_hist_dump(const struct shell *sh, size_t argc, char **argv)
+{
+	int age = (argc > 1) ? atoi(argv[1]) : 0;
+	int rows = (argc > 2) ? atoi(argv[2]) : 1;
+	int first_bin = (argc > 3) ? atoi(argv[3]) : HIST_FIRST_BIN;
+	int num_bins = (argc > 4) ? atoi(argv[4]) : HIST_BINS;
+
+	if ((age < 0) || (rows <= 0) || (first_bin < HIST_FIRST_BIN) || (num_bins <= 0))
+	{
+		shell_print(sh, "Uso: hist dump [idade linhas primeiro_bin num_bins]");
+		return -EINVAL;
+	}
+
+	int last_bin = MIN(first_bin + num_bins, HIST_FIRST_BIN + HIST_BINS);
+
+	for (int r = age; r < (age + rows); r++)
+	{
+		struct spectrum_history_row row;
+
+		if (spectrum_history_read(r, &row) != 0)
+		{
+			break;
+		}
+
+		shell_fprintf(sh, SHELL_NORMAL, "-%d frame %u, %f Hz/bin:", r, row.frame, (double)row.bin_hz);
+		for (int bin = first_bin; bin < last_bin; bin++)
+		{
+			shell_fprintf(sh, SHELL_NORMAL, " %f", (double)spectrum_history_decode(&row, bin - HIST_FIRST_BIN));
+		}
+		shell_fprintf(sh, SHELL_NORMAL, "\n");
+	}
+
+	return 0;
+}
+
+static int cmd_hist_raw(const struct shell *sh, size_t argc, char **argv)
+{
+	int age = (argc > 1) ? atoi(argv[1]) : 0;
+	int rows = (argc > 2) ? atoi(argv[2]) : (int)spectrum_history_count();
+
+	if ((age < 0) || (rows < 0))
+	{
+		shell_print(sh, "Uso: hist raw [idade linhas]");
+		return -EINVAL;
+	}
+
+	for (int r = age; r < (age + rows); r++)
+	{
+		struct spectrum_history_row row;
+
+		if (spectrum_history_read(r, &row) != 0)
+		{
+			break;
+		}
+
+		shell_hexdump(sh, (const uint8_t *)&row, sizeof(row));
+	}
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(hist,
+							   SHELL_CMD(info, NULL, "Estado do histórico", cmd_hist_info),
+							   SHELL_CMD_ARG(dump, NULL, "Magnitudes: [idade linhas primeiro_bin num_bins]", cmd_hist_dump, 1, 4),
+							   SHELL_CMD_ARG(raw, NULL, "Linhas codificadas em hex: [idade linhas]", cmd_hist_raw, 1, 2),
+							   SHELL_SUBCMD_SET_END);
+SHELL_CMD_REGISTER(hist, &hist, "Histórico de espectros", NULL);
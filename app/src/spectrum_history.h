@@ -0,0 +1,36 @@
+/*	Histórico compacto de espectros (waterfall)
+ */
+
+#ifndef APP_SRC_SPECTRUM_HISTORY_H_
+#define APP_SRC_SPECTRUM_HISTORY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Uma linha do histórico: max-hold de CONFIG_APP_SPECTRUM_HISTORY_DECIMATION
+// frames, em 8 bits log (0,5 dB por passo) relativo ao maior bin da linha.
+// O código 255 vale "peak" e o código 0 representa magnitude nula.
+struct spectrum_history_row
+{
+	uint32_t frame; // Número do último frame acumulado na linha
+	float bin_hz;	// Largura dos bins da linha (fs / len do FFT)
+	float peak;		// Magnitude linear do maior bin da linha
+	uint8_t bins[CONFIG_APP_SPECTRUM_HISTORY_BINS];
+};
+
+// Acumula um espectro de bins com largura bin_hz (chamado pela tarefa de FFT a
+// cada frame). Se a largura muda (dac len ou dac rate), o max-hold em curso é
+// descartado e recomeça, para uma linha nunca misturar larguras de bin.
+void spectrum_history_add(const float *mag, size_t len, float bin_hz);
+
+// Número de linhas disponíveis para leitura
+uint32_t spectrum_history_count(void);
+
+// Copia a linha de idade "age" (0 = mais recente) sem bloquear o escritor (ver
+// seqlock.h). Retorna -ENOENT se a linha não existe.
+int spectrum_history_read(uint32_t age, struct spectrum_history_row *row);
+
+// Converte o código de um bin de volta para magnitude linear
+float spectrum_history_decode(const struct spectrum_history_row *row, size_t bin);
+
+#endif /* APP_SRC_SPECTRUM_HISTORY_H_ */
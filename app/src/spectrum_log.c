@@ -0,0 +1,462 @@
+/*	Registro de espectros em flash (FCB circular)
+ *
+ * 	A tarefa de FFT acumula a média de alguns bins e, a cada
+ * 	CONFIG_APP_SPECTRUM_LOG_INTERVAL frames, coloca um registro numa fila sem
+ * 	esperar. Uma tarefa de baixa prioridade junta os registros em lotes e os
+ * 	grava no FCB da partição "storage". Quando o FCB enche, o setor mais antigo
+ * 	é apagado (fcb_rotate), distribuindo os apagamentos por toda a partição.
+ *
+ * 	A fila só evita que a tarefa de FFT espere pela gravação. No STM32G431 a
+ * 	flash tem um único banco: enquanto uma página é apagada (cerca de 22 ms) ou
+ * 	uma palavra dupla é programada, toda busca na flash para, inclusive a das
+ * 	interrupções e da tarefa de FFT, qualquer que seja a prioridade da tarefa de
+ * 	gravação. Os lotes concentram essas paradas: um apagamento a cada página
+ * 	cheia e uma rajada de programações por lote.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/fs/fcb.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/storage/flash_map.h>
+#include <zephyr/sys/crc.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/logging/log.h>
+
+#include <errno.h>
+#include <string.h>
+
+#include "spectrum_log.h"
+
+LOG_MODULE_REGISTER(spectrum_log, CONFIG_APP_LOG_LEVEL);
+
+#define SLOG_PARTITION_ID FIXED_PARTITION_ID(storage_partition)
+#define SLOG_MAX_SECTORS 16
+#define SLOG_MAGIC 0x534c4f47 // "SLOG"
+#define SLOG_BINS CONFIG_APP_SPECTRUM_LOG_BINS
+#define SLOG_FIRST_BIN CONFIG_APP_SPECTRUM_LOG_FIRST_BIN
+#define SLOG_BATCH CONFIG_APP_SPECTRUM_LOG_BATCH
+
+BUILD_ASSERT(SLOG_FIRST_BIN + SLOG_BINS <= (CONFIG_APP_FFT_MAX_LEN / 2), "Janela do registro fora do espectro útil");
+
+K_MSGQ_DEFINE(slog_queue, sizeof(struct spectrum_log_record), 2 * SLOG_BATCH, 4);
+K_MUTEX_DEFINE(slog_lock);
+
+static struct fcb slog_fcb;
+static struct flash_sector slog_sectors[SLOG_MAX_SECTORS];
+static bool slog_ready;
+static uint32_t slog_next_seq;
+static atomic_t slog_dropped;
+static atomic_t slog_written;
+
+// Estado do acumulador, acessado apenas pela tarefa de FFT
+static float slog_acc[SLOG_BINS];
+static uint32_t slog_acc_frames;
+static uint32_t slog_frame;
+
+static uint32_t slog_crc(const struct spectrum_log_record *rec)
+{
+	return crc32_ieee((const uint8_t *)rec, offsetof(struct spectrum_log_record, crc));
+}
+
+void spectrum_log_add(const float *mag, size_t len)
+{
+	slog_frame++;
+
+	for (int i = 0; i < SLOG_BINS; i++)
+	{
+		size_t bin = SLOG_FIRST_BIN + i;
+
+		slog_acc[i] += (bin < len) ? mag[bin] : 0.0f;
+	}
+
+	if (++slog_acc_frames < CONFIG_APP_SPECTRUM_LOG_INTERVAL)
+	{
+		return;
+	}
+
+	// Sequência e CRC são preenchidos pela tarefa de gravação
+	struct spectrum_log_record rec = {
+		.frame = slog_frame,
+		.uptime_ms = k_uptime_get_32(),
+	};
+
+	for (int i = 0; i < SLOG_BINS; i++)
+	{
+		rec.bins[i] = slog_acc[i] / (float)slog_acc_frames;
+		slog_acc[i] = 0.0f;
+	}
+	slog_acc_frames = 0;
+
+	if (k_msgq_put(&slog_queue, &rec, K_NO_WAIT) != 0)
+	{
+		atomic_inc(&slog_dropped);
+	}
+}
+
+// Lê o registro de uma entrada do FCB e valida tamanho e CRC
+static int slog_read_entry(struct fcb_entry_ctx *ctx, struct spectrum_log_record *rec)
+{
+	if (ctx->loc.fe_data_len != sizeof(*rec))
+	{
+		return -EBADMSG;
+	}
+
+	int ret = flash_area_read(ctx->fap, FCB_ENTRY_FA_DATA_OFF(ctx->loc), rec, sizeof(*rec));
+	if (ret != 0)
+	{
+		return ret;
+	}
+
+	return (slog_crc(rec) == rec->crc) ? 0 : -EBADMSG;
+}
+
+static int slog_last_seq_cb(struct fcb_entry_ctx *ctx, void *arg)
+{
+	uint32_t *next_seq = arg;
+	struct spectrum_log_record rec;
+
+	if ((slog_read_entry(ctx, &rec) == 0) && (rec.seq >= *next_seq))
+	{
+		*next_seq = rec.seq + 1;
+	}
+
+	return 0;
+}
+
+static int slog_erase_partition(void)
+{
+	const struct flash_area *fa;
+
+	int ret = flash_area_open(SLOG_PARTITION_ID, &fa);
+	if (ret != 0)
+	{
+		return ret;
+	}
+
+	ret = flash_area_erase(fa, 0, fa->fa_size);
+	flash_area_close(fa);
+
+	return ret;
+}
+
+int spectrum_log_init(void)
+{
+	uint32_t sector_cnt = ARRAY_SIZE(slog_sectors);
+
+	k_mutex_lock(&slog_lock, K_FOREVER);
+	slog_ready = false;
+
+	int ret = flash_area_get_sectors(SLOG_PARTITION_ID, &sector_cnt, slog_sectors);
+	if (ret != 0)
+	{
+		LOG_ERR("Could not read storage sectors (%d)", ret);
+		k_mutex_unlock(&slog_lock);
+		return ret;
+	}
+
+	slog_fcb.f_magic = SLOG_MAGIC;
+	slog_fcb.f_version = 1;
+	slog_fcb.f_sector_cnt = (uint8_t)sector_cnt;
+	slog_fcb.f_scratch_cnt = 0;
+	slog_fcb.f_sectors = slog_sectors;
+
+	ret = fcb_init(SLOG_PARTITION_ID, &slog_fcb);
+	if (ret == -ENOMSG)
+	{
+		// Setor com o magic de outro formato (ou de outro layout, como na
+		// primeira partida depois de a partição mudar de lugar). O fcb_init
+		// falha antes de montar o FCB, então fcb_clear não serve: apaga a
+		// partição inteira e monta de novo. Erros de leitura não chegam
+		// aqui, para não apagar os registros por causa de uma falha passageira.
+		LOG_WRN("Storage holds another format, erasing it");
+		ret = slog_erase_partition();
+		if (ret == 0)
+		{
+			ret = fcb_init(SLOG_PARTITION_ID, &slog_fcb);
+		}
+	}
+	if (ret != 0)
+	{
+		LOG_ERR("Could not mount storage (%d)", ret);
+		k_mutex_unlock(&slog_lock);
+		return ret;
+	}
+
+	// Continua a sequência a partir do último registro válido
+	slog_next_seq = 0;
+	fcb_walk(&slog_fcb, NULL, slog_last_seq_cb, &slog_next_seq);
+	slog_ready = true;
+	k_mutex_unlock(&slog_lock);
+
+	LOG_INF("Spectrum log ready, %u sectors, next seq %u", sector_cnt, slog_next_seq);
+
+	return 0;
+}
+
+static int slog_append(struct spectrum_log_record *rec)
+{
+	struct fcb_entry loc;
+
+	if (!slog_ready)
+	{
+		return -ENODEV;
+	}
+
+	rec->seq = slog_next_seq;
+	rec->crc = slog_crc(rec);
+
+	int ret = fcb_append(&slog_fcb, sizeof(*rec), &loc);
+	if (ret == -ENOSPC)
+	{
+		// Cheio: descarta o setor mais antigo
+		ret = fcb_rotate(&slog_fcb);
+		if (ret == 0)
+		{
+			ret = fcb_append(&slog_fcb, sizeof(*rec), &loc);
+		}
+	}
+	if (ret != 0)
+	{
+		return ret;
+	}
+
+	ret = flash_area_write(slog_fcb.fap, FCB_ENTRY_FA_DATA_OFF(loc), rec, sizeof(*rec));
+	if (ret != 0)
+	{
+		return ret;
+	}
+
+	ret = fcb_append_finish(&slog_fcb, &loc);
+	if (ret == 0)
+	{
+		slog_next_seq++;
+		atomic_inc(&slog_written);
+	}
+
+	return ret;
+}
+
+int spectrum_log_append(struct spectrum_log_record *rec)
+{
+	k_mutex_lock(&slog_lock, K_FOREVER);
+	int ret = slog_append(rec);
+	k_mutex_unlock(&slog_lock);
+
+	return ret;
+}
+
+struct slog_walk_ctx
+{
+	spectrum_log_walk_cb_t cb;
+	void *arg;
+};
+
+static int slog_walk_cb(struct fcb_entry_ctx *ctx, void *arg)
+{
+	struct slog_walk_ctx *walk = arg;
+	struct spectrum_log_record rec;
+	int err = slog_read_entry(ctx, &rec);
+
+	if ((err != 0) && (err != -EBADMSG))
+	{
+		return err;
+	}
+
+	return walk->cb(&rec, err, walk->arg);
+}
+
+int spectrum_log_walk(spectrum_log_walk_cb_t cb, void *arg)
+{
+	struct slog_walk_ctx walk = {.cb = cb, .arg = arg};
+	int ret = -ENODEV;
+
+	// A gravação espera o fim da leitura; a fila absorve os registros novos
+	k_mutex_lock(&slog_lock, K_FOREVER);
+	if (slog_ready)
+	{
+		ret = fcb_walk(&slog_fcb, NULL, slog_walk_cb, &walk);
+	}
+	k_mutex_unlock(&slog_lock);
+
+	return ret;
+}
+
+int spectrum_log_clear(void)
+{
+	int ret = -ENODEV;
+
+	k_mutex_lock(&slog_lock, K_FOREVER);
+	if (slog_ready)
+	{
+		ret = fcb_clear(&slog_fcb);
+	}
+	k_mutex_unlock(&slog_lock);
+
+	return ret;
+}
+
+uint32_t spectrum_log_next_seq(void)
+{
+	k_mutex_lock(&slog_lock, K_FOREVER);
+	uint32_t seq = slog_next_seq;
+	k_mutex_unlock(&slog_lock);
+
+	return seq;
+}
+
+static void slog_write_batch(struct spectrum_log_record *batch, int count)
+{
+	k_mutex_lock(&slog_lock, K_FOREVER);
+	for (int i = 0; i < count; i++)
+	{
+		int ret = slog_append(&batch[i]);
+		if (ret != 0)
+		{
+			LOG_ERR("Could not append record (%d)", ret);
+			atomic_add(&slog_dropped, count - i);
+			break;
+		}
+	}
+	k_mutex_unlock(&slog_lock);
+}
+
+// Tarefa de gravação. Junta registros em lotes antes de escrever na flash
+void spectrum_log_task(void)
+{
+	static struct spectrum_log_record batch[SLOG_BATCH];
+
+	if (spectrum_log_init() != 0)
+	{
+		return;
+	}
+
+	while (1)
+	{
+		int count = 0;
+		int64_t deadline = 0;
+
+		while (count < SLOG_BATCH)
+		{
+			k_timeout_t timeout = K_FOREVER;
+
+			if (count > 0)
+			{
+				int64_t remaining = deadline - k_uptime_get();
+				if (remaining <= 0)
+				{
+					break;
+				}
+				timeout = K_MSEC(remaining);
+			}
+
+			if (k_msgq_get(&slog_queue, &batch[count], timeout) != 0)
+			{
+				break;
+			}
+
+			if (count == 0)
+			{
+				deadline = k_uptime_get() + CONFIG_APP_SPECTRUM_LOG_FLUSH_MS;
+			}
+			count++;
+		}
+
+		slog_write_batch(batch, count);
+	}
+}
+
+K_THREAD_DEFINE(spectrum_log_task_th, 1024, spectrum_log_task, NULL, NULL, NULL,
+				CONFIG_APP_SPECTRUM_LOG_THREAD_PRIORITY, 0, 0);
+
+// =============================== Shell ===============================
+
+static int slog_export_cb(const struct spectrum_log_record *rec, int err, void *arg)
+{
+	const struct shell *sh = arg;
+
+	if (err != 0)
+	{
+		shell_print(sh, "# registro invalido (%d)", err);
+		return 0;
+	}
+
+	shell_fprintf(sh, SHELL_NORMAL, "%u,%u,%u", rec->seq, rec->frame, rec->uptime_ms);
+	for (int i = 0; i < SLOG_BINS; i++)
+	{
+		shell_fprintf(sh, SHELL_NORMAL, ",%f", (double)rec->bins[i]);
+	}
+	shell_fprintf(sh, SHELL_NORMAL, "\n");
+
+	return 0;
+}
+
+static int cmd_slog_info(const struct shell *sh, size_t argc, char **argv)
+{
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	if (!slog_ready)
+	{
+		shell_error(sh, "Registro indisponivel");
+		return -ENODEV;
+	}
+
+	k_mutex_lock(&slog_lock, K_FOREVER);
+	shell_print(sh, "Setores: %u (%d livres), proxima sequencia: %u", slog_fcb.f_sector_cnt,
+				fcb_free_sector_cnt(&slog_fcb), slog_next_seq);
+	k_mutex_unlock(&slog_lock);
+
+	shell_print(sh, "Gravados: %ld, descartados: %ld, na fila: %u", (long)atomic_get(&slog_written),
+				(long)atomic_get(&slog_dropped), k_msgq_num_used_get(&slog_queue));
+
+	return 0;
+}
+
+static int cmd_slog_export(const struct shell *sh, size_t argc, char **argv)
+{
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	if (!slog_ready)
+	{
+		shell_error(sh, "Registro indisponivel");
+		return -ENODEV;
+	}
+
+	shell_fprintf(sh, SHELL_NORMAL, "seq,frame,uptime_ms");
+	for (int i = 0; i < SLOG_BINS; i++)
+	{
+		shell_fprintf(sh, SHELL_NORMAL, ",bin%d", SLOG_FIRST_BIN + i);
+	}
+	shell_fprintf(sh, SHELL_NORMAL, "\n");
+
+	return spectrum_log_walk(slog_export_cb, (void *)sh);
+}
+
+static int cmd_slog_erase(const struct shell *sh, size_t argc, char **argv)
+{
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	if (!slog_ready)
+	{
+		shell_error(sh, "Registro indisponivel");
+		return -ENODEV;
+	}
+
+	int ret = spectrum_log_clear();
+
+	if (ret != 0)
+	{
+		shell_error(sh, "Falha ao apagar (%d)", ret);
+	}
+
+	return ret;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(slog,
+							   SHELL_CMD(info, NULL, "Estado do registro em flash", cmd_slog_info),
+							   SHELL_CMD(export, NULL, "Exporta os registros em CSV", cmd_slog_export),
+							   SHELL_CMD(erase, NULL, "Apaga todos os registros", cmd_slog_erase),
+							   SHELL_SUBCMD_SET_END);
+SHELL_CMD_REGISTER(slog, &slog, "Registro de espectros em flash", NULL);
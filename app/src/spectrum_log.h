@@ -0,0 +1,47 @@
+/*	Registro de espectros em flash (FCB circular)
+ */
+
+#ifndef APP_SRC_SPECTRUM_LOG_H_
+#define APP_SRC_SPECTRUM_LOG_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Registro gravado na flash: média de CONFIG_APP_SPECTRUM_LOG_INTERVAL frames
+struct spectrum_log_record
+{
+	uint32_t seq;		// Sequência, continua após reset
+	uint32_t frame;		// Último frame do intervalo
+	uint32_t uptime_ms; // Tempo desde o boot no fim do intervalo
+	float bins[CONFIG_APP_SPECTRUM_LOG_BINS];
+	uint32_t crc; // CRC32 (IEEE) de todos os campos anteriores
+};
+
+// Recebe cada registro percorrido por spectrum_log_walk() com err = 0, ou com
+// err = -EBADMSG se o tamanho ou o CRC não conferem. Retornar diferente de
+// zero interrompe a leitura.
+typedef int (*spectrum_log_walk_cb_t)(const struct spectrum_log_record *rec, int err, void *arg);
+
+// Acumula um espectro (chamado pela tarefa de FFT a cada frame, nunca bloqueia)
+void spectrum_log_add(const float *mag, size_t len);
+
+// Monta o FCB da partição "storage" e continua a sequência a partir do último
+// registro válido. A partição só é apagada se tiver conteúdo de outro formato
+// (-ENOMSG do fcb_init); os outros erros são retornados. Chamada pela tarefa
+// de gravação no boot; pode ser chamada de novo para remontar o FCB.
+int spectrum_log_init(void);
+
+// Grava um registro, preenchendo seq e crc. Com o FCB cheio descarta antes o
+// setor mais antigo. Retorna -ENODEV se o registro não foi montado.
+int spectrum_log_append(struct spectrum_log_record *rec);
+
+// Percorre os registros do mais antigo ao mais novo
+int spectrum_log_walk(spectrum_log_walk_cb_t cb, void *arg);
+
+// Apaga todos os registros; a sequência continua
+int spectrum_log_clear(void);
+
+// Sequência do próximo registro gravado
+uint32_t spectrum_log_next_seq(void);
+
+#endif /* APP_SRC_SPECTRUM_LOG_H_ */
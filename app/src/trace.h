@@ -0,0 +1,28 @@
+/*	Pontos de trace (CTF) dos estágios do pipeline
+ *
+ * 	Com CONFIG_APP_TRACE cada estágio emite um evento nomeado do CTF no início
+ * 	(arg1 = 0) e no fim (arg1 = 1), com o número do frame em arg0. Eventos
+ * 	pontuais usam arg1 = 2. Os nomes são truncados em 20 caracteres pelo CTF.
+ * 	Sem CONFIG_APP_TRACE as macros só avaliam o número do frame.
+ */
+
+#ifndef APP_SRC_TRACE_H_
+#define APP_SRC_TRACE_H_
+
+#if defined(CONFIG_APP_TRACE)
+
+#include <zephyr/tracing/tracing.h>
+
+#define APP_TRACE_BEGIN(stage, frame) sys_trace_named_event(stage, frame, 0)
+#define APP_TRACE_END(stage, frame) sys_trace_named_event(stage, frame, 1)
+#define APP_TRACE_POINT(stage, frame) sys_trace_named_event(stage, frame, 2)
+
+#else
+
+#define APP_TRACE_BEGIN(stage, frame) ((void)(frame))
+#define APP_TRACE_END(stage, frame) ((void)(frame))
+#define APP_TRACE_POINT(stage, frame) ((void)(frame))
+
+#endif
+
+#endif /* APP_SRC_TRACE_H_ */
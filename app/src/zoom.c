@@ -0,0 +1,392 @@
+/*	Zoom FFT: espectro de alta resolução numa faixa em torno de uma frequência
+ *
+ * 	As amostras condicionadas de cada frame são deslocadas para banda base por
+ * 	um oscilador complexo (NCO: acumulador de fase de 32 bits, com seno e
+ * 	cosseno recalculados a cada bloco e girados amostra a amostra dentro
+ * 	dele), filtradas e decimadas por dois arm_fir_decimate_f32 (I e Q, mesmos
+ * 	coeficientes). A cada CONFIG_APP_ZOOM_LEN amostras decimadas roda uma FFT
+ * 	complexa com janela de Hann.
+ *
+ * 	Com decimação D a taxa cai para fs / D e a resolução fica D *
+ * 	CONFIG_APP_ZOOM_LEN / dsp_len() vezes mais fina que a da FFT principal,
+ * 	com buffers do tamanho de CONFIG_APP_ZOOM_LEN. O passa-baixas (sinc com
+ * 	janela de Hamming, 16 * D taps, corte em 0,375 * fs / D) é plano e livre
+ * 	de aliasing em +-fs / (4 * D): só essa metade central do espectro é
+ * 	publicada.
+ *
+ * 	O resultado é publicado com um seqlock (seqlock.h), como em dsp.c.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/util.h>
+
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arm_const_structs.h"
+
+#include "acq.h"
+#include "dsp.h"
+#include "seqlock.h"
+#include "zoom.h"
+
+#define ZOOM_LEN CONFIG_APP_ZOOM_LEN
+#define ZOOM_BINS (ZOOM_LEN / 2)
+#define ZOOM_MAX_DECIM CONFIG_APP_ZOOM_MAX_DECIMATION
+#define ZOOM_TAPS_PER_DECIM 16
+#define ZOOM_MAX_TAPS (ZOOM_TAPS_PER_DECIM * ZOOM_MAX_DECIM)
+// Bloco do NCO e dos filtros: todo frame é múltiplo dele
+#define ZOOM_BLOCK DSP_MIN_LEN
+
+#define ZOOM_PI 3.14159265358979f
+#define ZOOM_PHASE_TO_RAD (2.0f * ZOOM_PI / 4294967296.0f)
+
+// Bins impressos por leitura em "zoom dump"
+#define ZOOM_PRINT_CHUNK 32
+
+#define ZOOM_CFFT_(n) arm_cfft_sR_f32_len##n
+#define ZOOM_CFFT(n) ZOOM_CFFT_(n)
+
+BUILD_ASSERT(IS_POWER_OF_TWO(ZOOM_LEN) && (ZOOM_LEN >= 64) && (ZOOM_LEN <= 4096),
+			 "CONFIG_APP_ZOOM_LEN deve ser potência de 2 entre 64 e 4096");
+BUILD_ASSERT(IS_POWER_OF_TWO(ZOOM_MAX_DECIM) && (ZOOM_MAX_DECIM >= 2) && (ZOOM_MAX_DECIM <= ZOOM_BLOCK),
+			 "CONFIG_APP_ZOOM_MAX_DECIMATION deve ser potência de 2 entre 2 e 64");
+
+// Configuração pedida por zoom_set(); span_hz = 0 desliga o zoom
+struct zoom_config
+{
+	uint32_t center_hz;
+	uint32_t span_hz;
+};
+
+K_MSGQ_DEFINE(zoom_config_q, sizeof(struct zoom_config), 1, 4);
+
+// Estado do processamento, acessado apenas pela tarefa de FFT
+static struct zoom_config zoom_config;
+static float zoom_fs;
+static uint32_t zoom_phase;
+static uint32_t zoom_step;
+static float zoom_rot_c;
+static float zoom_rot_s;
+
+static float zoom_coeffs[ZOOM_MAX_TAPS];
+static float zoom_state_i[ZOOM_MAX_TAPS + ZOOM_BLOCK - 1];
+static float zoom_state_q[ZOOM_MAX_TAPS + ZOOM_BLOCK - 1];
+static arm_fir_decimate_instance_f32 zoom_fir_i;
+static arm_fir_decimate_instance_f32 zoom_fir_q;
+
+static float zoom_mix_i[ZOOM_BLOCK];
+static float zoom_mix_q[ZOOM_BLOCK];
+static float zoom_dec_i[ZOOM_BLOCK / 2];
+static float zoom_dec_q[ZOOM_BLOCK / 2];
+
+// Amostras decimadas (re, im intercalados); a FFT roda no próprio buffer
+static float zoom_buf[2 * ZOOM_LEN];
+static size_t zoom_fill;
+
+// Resultado: contador ímpar enquanto a tarefa de FFT escreve
+static atomic_t zoom_seq;
+static float zoom_mag[ZOOM_BINS];
+static struct zoom_spectrum zoom_info;
+
+// Maior decimação cuja faixa útil (fs / (2 * D)) ainda cobre span_hz
+static uint32_t zoom_decim_for_span(float fs_hz, uint32_t span_hz)
+{
+	uint32_t decim = 2;
+
+	while (((decim * 2) <= ZOOM_MAX_DECIM) && ((fs_hz / (float)(4 * decim)) >= (float)span_hz))
+	{
+		decim *= 2;
+	}
+
+	return decim;
+}
+
+// Passa-baixas sinc com janela de Hamming e ganho unitário em DC. Simétrico,
+// então a ordem invertida que a CMSIS-DSP espera é a mesma.
+static void zoom_design(uint32_t decim)
+{
+	size_t taps = ZOOM_TAPS_PER_DECIM * decim;
+	float fc = 0.375f / (float)decim;
+	float mid = (float)(taps - 1) / 2.0f;
+	float sum = 0.0f;
+
+	for (size_t k = 0; k < taps; k++)
+	{
+		// taps é par: t nunca é zero
+		float t = (float)k - mid;
+		float h = sinf(2.0f * ZOOM_PI * fc * t) / (ZOOM_PI * t);
+		float w = 0.54f - (0.46f * cosf(2.0f * ZOOM_PI * (float)k / (float)(taps - 1)));
+
+		zoom_coeffs[k] = h * w;
+		sum += zoom_coeffs[k];
+	}
+
+	for (size_t k = 0; k < taps; k++)
+	{
+		zoom_coeffs[k] /= sum;
+	}
+}
+
+static void zoom_apply(const struct zoom_config *cfg, float fs_hz)
+{
+	zoom_config = *cfg;
+	zoom_fs = fs_hz;
+	zoom_fill = 0;
+
+	seqlock_write_begin(&zoom_seq);
+	zoom_info = (struct zoom_spectrum){0};
+
+	if (cfg->span_hz > 0)
+	{
+		uint32_t decim = zoom_decim_for_span(fs_hz, cfg->span_hz);
+		uint16_t taps = ZOOM_TAPS_PER_DECIM * decim;
+
+		zoom_design(decim);
+		arm_fir_decimate_init_f32(&zoom_fir_i, taps, decim, zoom_coeffs, zoom_state_i, ZOOM_BLOCK);
+		arm_fir_decimate_init_f32(&zoom_fir_q, taps, decim, zoom_coeffs, zoom_state_q, ZOOM_BLOCK);
+
+		zoom_phase = 0;
+		zoom_step = (uint32_t)llround(((double)cfg->center_hz / fs_hz) * 4294967296.0);
+		zoom_rot_c = cosf((float)zoom_step * ZOOM_PHASE_TO_RAD);
+		zoom_rot_s = sinf((float)zoom_step * ZOOM_PHASE_TO_RAD);
+
+		zoom_info.decim = decim;
+		zoom_info.center_hz = (float)cfg->center_hz;
+		zoom_info.bin_hz = fs_hz / (float)(decim * ZOOM_LEN);
+		zoom_info.first_hz = zoom_info.center_hz - ((ZOOM_LEN / 4) * zoom_info.bin_hz);
+	}
+
+	seqlock_write_end(&zoom_seq);
+}
+
+static void zoom_spectrum(void)
+{
+	float *buf = zoom_buf;
+
+	for (size_t k = 0; k < ZOOM_LEN; k++)
+	{
+		float w = 0.5f - (0.5f * cosf(2.0f * ZOOM_PI * (float)k / ZOOM_LEN));
+
+		buf[2 * k] *= w;
+		buf[(2 * k) + 1] *= w;
+	}
+
+	arm_cfft_f32(&ZOOM_CFFT(CONFIG_APP_ZOOM_LEN), buf, 0, 1);
+
+	// Faixa útil em ordem de frequência: bins negativos [3N/4, N) e depois os
+	// positivos [0, N/4). Escala: metade da amplitude fica na frequência
+	// positiva do sinal real e o ganho coerente da janela é 0,5.
+	seqlock_write_begin(&zoom_seq);
+	arm_cmplx_mag_f32(&buf[2 * (ZOOM_LEN - (ZOOM_LEN / 4))], zoom_mag, ZOOM_LEN / 4);
+	arm_cmplx_mag_f32(buf, &zoom_mag[ZOOM_LEN / 4], ZOOM_LEN / 4);
+	arm_scale_f32(zoom_mag, 4.0f / ZOOM_LEN, zoom_mag, ZOOM_BINS);
+	zoom_info.count++;
+	seqlock_write_end(&zoom_seq);
+}
+
+static void zoom_block(const int16_t *q15)
+{
+	float theta = (float)zoom_phase * ZOOM_PHASE_TO_RAD;
+	float c = cosf(theta);
+	float s = sinf(theta);
+
+	// Multiplica por exp(-j * theta) e gira o oscilador a cada amostra
+	for (size_t k = 0; k < ZOOM_BLOCK; k++)
+	{
+		float v = (float)q15[k] * DSP_Q15_VOLTS;
+		float next_c = (c * zoom_rot_c) - (s * zoom_rot_s);
+
+		zoom_mix_i[k] = v * c;
+		zoom_mix_q[k] = -v * s;
+		s = (s * zoom_rot_c) + (c * zoom_rot_s);
+		c = next_c;
+	}
+	zoom_phase += zoom_step * ZOOM_BLOCK;
+
+	arm_fir_decimate_f32(&zoom_fir_i, zoom_mix_i, zoom_dec_i, ZOOM_BLOCK);
+	arm_fir_decimate_f32(&zoom_fir_q, zoom_mix_q, zoom_dec_q, ZOOM_BLOCK);
+
+	for (size_t j = 0; j < (ZOOM_BLOCK / zoom_fir_i.M); j++)
+	{
+		zoom_buf[2 * zoom_fill] = zoom_dec_i[j];
+		zoom_buf[(2 * zoom_fill) + 1] = zoom_dec_q[j];
+
+		if (++zoom_fill == ZOOM_LEN)
+		{
+			zoom_spectrum();
+			zoom_fill = 0;
+		}
+	}
+}
+
+void zoom_update(const int16_t *q15, size_t n, float fs_hz)
+{
+	struct zoom_config cfg;
+
+	if (k_msgq_get(&zoom_config_q, &cfg, K_NO_WAIT) == 0)
+	{
+		zoom_apply(&cfg, fs_hz);
+	}
+	else if ((zoom_config.span_hz > 0) && (fs_hz != zoom_fs))
+	{
+		// A taxa do ADC mudou: refaz o filtro e o oscilador
+		zoom_apply(&zoom_config, fs_hz);
+	}
+
+	if (zoom_config.span_hz == 0)
+	{
+		return;
+	}
+
+	for (size_t off = 0; (off + ZOOM_BLOCK) <= n; off += ZOOM_BLOCK)
+	{
+		zoom_block(&q15[off]);
+	}
+}
+
+int zoom_read(size_t first, size_t count, float *out, struct zoom_spectrum *info)
+{
+	atomic_val_t seq;
+	bool valid;
+	size_t n;
+
+	do
+	{
+		seq = seqlock_read_begin(&zoom_seq);
+
+		*info = zoom_info;
+		valid = info->count > 0;
+		n = (valid && (first < ZOOM_BINS)) ? MIN(count, ZOOM_BINS - first) : 0;
+
+		if (n > 0)
+		{
+			memcpy(out, &zoom_mag[first], n * sizeof(float));
+		}
+	} while (seqlock_read_retry(&zoom_seq, seq));
+
+	return valid ? (int)n : -ENODATA;
+}
+
+void zoom_set(uint32_t center_hz, uint32_t span_hz)
+{
+	struct zoom_config cfg = {.center_hz = center_hz, .span_hz = span_hz};
+
+	k_msgq_purge(&zoom_config_q);
+	k_msgq_put(&zoom_config_q, &cfg, K_NO_WAIT);
+}
+
+// =============================== Shell ===============================
+
+static int cmd_zoom_set(const struct shell *sh, size_t argc, char **argv)
+{
+	int center = atoi(argv[1]);
+	int span = atoi(argv[2]);
+	uint32_t fs = acq_adc_get_rate();
+
+	if ((center <= 0) || (center >= (int)(fs / 2)) || (span <= 0))
+	{
+		shell_print(sh, "Uso: set centro_Hz span_Hz (centro entre 0 e %u Hz)", fs / 2);
+		return -EINVAL;
+	}
+
+	uint32_t decim = zoom_decim_for_span((float)fs, span);
+
+	zoom_set(center, span);
+	shell_print(sh, "Decimacao %u: faixa de %u Hz, resolucao %f Hz (FFT principal: %f Hz)", decim, fs / (2 * decim),
+				(double)((float)fs / (float)(decim * ZOOM_LEN)), (double)((float)fs / (float)dsp_len()));
+	if ((fs / (2 * decim)) < (uint32_t)span)
+	{
+		shell_print(sh, "(span limitado pela decimacao minima)");
+	}
+
+	return 0;
+}
+
+static int cmd_zoom_off(const struct shell *sh, size_t argc, char **argv)
+{
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	zoom_set(0, 0);
+
+	return 0;
+}
+
+static int cmd_zoom_info(const struct shell *sh, size_t argc, char **argv)
+{
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	struct zoom_spectrum info;
+	float unused;
+
+	if (zoom_read(0, 0, &unused, &info) < 0)
+	{
+		shell_print(sh, "Zoom desligado ou sem espectro ainda");
+		return 0;
+	}
+
+	shell_print(sh, "Centro %f Hz, decimacao %u, %d bins de %f a %f Hz, resolucao %f Hz, %u espectros",
+				(double)info.center_hz, info.decim, ZOOM_BINS, (double)info.first_hz,
+				(double)(info.first_hz + ((ZOOM_BINS - 1) * info.bin_hz)), (double)info.bin_hz, info.count);
+
+	return 0;
+}
+
+static int cmd_zoom_dump(const struct shell *sh, size_t argc, char **argv)
+{
+	int first = (argc > 1) ? atoi(argv[1]) : 0;
+	int count = (argc > 2) ? atoi(argv[2]) : ZOOM_BINS;
+	float mag[ZOOM_PRINT_CHUNK];
+	struct zoom_spectrum info;
+	uint32_t spectrum = 0;
+
+	if ((first < 0) || (count < 0))
+	{
+		shell_print(sh, "Uso: dump [primeiro_bin num_bins]");
+		return -EINVAL;
+	}
+
+	shell_print(sh, "# frequencia (Hz), amplitude (V)");
+
+	for (int done = 0; done < count;)
+	{
+		int n = zoom_read(first + done, MIN(count - done, ZOOM_PRINT_CHUNK), mag, &info);
+
+		if (n < 0)
+		{
+			shell_print(sh, "Zoom desligado ou sem espectro ainda");
+			return n;
+		}
+		if (n == 0)
+		{
+			break;
+		}
+		if ((spectrum != 0) && (info.count != spectrum))
+		{
+			shell_print(sh, "(espectro novo a partir daqui)");
+		}
+		spectrum = info.count;
+
+		for (int i = 0; i < n; i++)
+		{
+			shell_print(sh, "%f,%f", (double)(info.first_hz + ((first + done + i) * info.bin_hz)), (double)mag[i]);
+		}
+		done += n;
+	}
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(zoom,
+							   SHELL_CMD_ARG(set, NULL, "Liga o zoom: set centro_Hz span_Hz", cmd_zoom_set, 3, 0),
+							   SHELL_CMD(off, NULL, "Desliga o zoom", cmd_zoom_off),
+							   SHELL_CMD(info, NULL, "Faixa e resolucao do zoom", cmd_zoom_info),
+							   SHELL_CMD_ARG(dump, NULL, "Amplitudes em CSV: [primeiro_bin num_bins]", cmd_zoom_dump, 1, 2),
+							   SHELL_SUBCMD_SET_END);
+SHELL_CMD_REGISTER(zoom, &zoom, "Zoom FFT em torno de uma frequencia", NULL);
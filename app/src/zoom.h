@@ -0,0 +1,37 @@
+/*	Zoom FFT: espectro de alta resolução numa faixa em torno de uma frequência
+ */
+
+#ifndef APP_SRC_ZOOM_H_
+#define APP_SRC_ZOOM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Identificação do último espectro do zoom
+struct zoom_spectrum
+{
+	uint32_t count;	  // Espectros calculados desde a última configuração
+	uint32_t decim;	  // Fator de decimação
+	float center_hz;  // Frequência central (a do oscilador)
+	float first_hz;	  // Frequência do primeiro bin
+	float bin_hz;	  // Resolução (fs / (decim * CONFIG_APP_ZOOM_LEN))
+};
+
+// Alimenta o zoom com as amostras condicionadas de um frame (chamado pela
+// tarefa de FFT). Aplica a configuração pedida pelo shell e calcula um
+// espectro a cada CONFIG_APP_ZOOM_LEN amostras decimadas.
+void zoom_update(const int16_t *q15, size_t n, float fs_hz);
+
+// Pede o zoom em torno de center_hz cobrindo pelo menos span_hz (limitado pela
+// decimação máxima); span_hz = 0 desliga. A tarefa de FFT aplica o pedido no
+// próximo frame, e só o último pedido pendente vale.
+void zoom_set(uint32_t center_hz, uint32_t span_hz);
+
+// Copia as amplitudes (V de pico) dos bins [first, first + count) da faixa
+// útil, em ordem crescente de frequência (CONFIG_APP_ZOOM_LEN / 2 bins).
+// Nunca bloqueia a tarefa de FFT (ver seqlock.h). Só pode ser chamada de uma
+// thread. Retorna o número de bins copiados ou
+// -ENODATA se o zoom está desligado ou ainda não calculou um espectro.
+int zoom_read(size_t first, size_t count, float *out, struct zoom_spectrum *info);
+
+#endif /* APP_SRC_ZOOM_H_ */
@@ -8,18 +8,124 @@
 #include <zephyr/device.h>
 #include <zephyr/drivers/gpio.h>
 #include <zephyr/drivers/sensor.h>
+#include <zephyr/spinlock.h>
+#include <zephyr/sys/slist.h>
+
+#include <app/drivers/examplesensor.h>
 
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(examplesensor, CONFIG_SENSOR_LOG_LEVEL);
 
 struct examplesensor_data {
 	int state;
+#ifdef CONFIG_EXAMPLESENSOR_BANK
+	sys_snode_t node;
+	const struct device *dev;
+#endif
 };
 
 struct examplesensor_config {
 	struct gpio_dt_spec input;
 };
 
+#ifdef CONFIG_EXAMPLESENSOR_BANK
+/* All the instances whose input pin is on the same GPIO port */
+struct examplesensor_bank {
+	const struct device *port;
+	gpio_port_pins_t mask;
+	gpio_port_pins_t active_low;
+	gpio_port_value_t states;
+	sys_slist_t sensors;
+};
+
+static struct examplesensor_bank banks[CONFIG_EXAMPLESENSOR_BANK_MAX_PORTS];
+static struct k_spinlock banks_lock;
+
+static int examplesensor_bank_add(const struct device *dev)
+{
+	const struct examplesensor_config *config = dev->config;
+	struct examplesensor_data *data = dev->data;
+	struct examplesensor_bank *bank = NULL;
+
+	for (size_t i = 0; i < ARRAY_SIZE(banks); i++) {
+		if (banks[i].port == config->input.port || banks[i].port == NULL) {
+			bank = &banks[i];
+			break;
+		}
+	}
+
+	if (bank == NULL) {
+		LOG_ERR("No free bank, increase CONFIG_EXAMPLESENSOR_BANK_MAX_PORTS");
+		return -ENOMEM;
+	}
+
+	bank->port = config->input.port;
+	bank->mask |= BIT(config->input.pin);
+	if (config->input.dt_flags & GPIO_ACTIVE_LOW) {
+		bank->active_low |= BIT(config->input.pin);
+	}
+
+	data->dev = dev;
+	sys_slist_append(&bank->sensors, &data->node);
+
+	return 0;
+}
+
+int examplesensor_bank_fetch(void)
+{
+	int ret = 0;
+
+	for (size_t i = 0; i < ARRAY_SIZE(banks) && banks[i].port != NULL; i++) {
+		struct examplesensor_bank *bank = &banks[i];
+		struct examplesensor_data *data;
+		gpio_port_value_t raw;
+		k_spinlock_key_t key;
+		int err;
+
+		err = gpio_port_get_raw(bank->port, &raw);
+		if (err < 0) {
+			ret = (ret == 0) ? err : ret;
+			continue;
+		}
+
+		key = k_spin_lock(&banks_lock);
+		bank->states = (raw ^ bank->active_low) & bank->mask;
+
+		SYS_SLIST_FOR_EACH_CONTAINER(&bank->sensors, data, node) {
+			const struct examplesensor_config *config = data->dev->config;
+
+			data->state = (bank->states & BIT(config->input.pin)) != 0;
+		}
+		k_spin_unlock(&banks_lock, key);
+	}
+
+	return ret;
+}
+
+int examplesensor_bank_get(const struct device *port, gpio_port_pins_t *states,
+			   gpio_port_pins_t *mask)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(banks) && banks[i].port != NULL; i++) {
+		if (banks[i].port != port) {
+			continue;
+		}
+
+		k_spinlock_key_t key = k_spin_lock(&banks_lock);
+
+		*states = banks[i].states;
+		k_spin_unlock(&banks_lock, key);
+
+		if (mask != NULL) {
+			*mask = banks[i].mask;
+		}
+
+		return 0;
+	}
+
+	return -ENOENT;
+}
+#endif /* CONFIG_EXAMPLESENSOR_BANK */
+
 static int examplesensor_sample_fetch(const struct device *dev,
 				      enum sensor_channel chan)
 {
@@ -68,6 +174,13 @@ static int examplesensor_init(const struct device *dev)
 		return ret;
 	}
 
+#ifdef CONFIG_EXAMPLESENSOR_BANK
+	ret = examplesensor_bank_add(dev);
+	if (ret < 0) {
+		return ret;
+	}
+#endif
+
 	return 0;
 }
 
@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef EXAMPLE_APPLICATION_INCLUDE_APP_DRIVERS_EXAMPLESENSOR_H_
+#define EXAMPLE_APPLICATION_INCLUDE_APP_DRIVERS_EXAMPLESENSOR_H_
+
+#include <zephyr/device.h>
+#include <zephyr/drivers/gpio.h>
+
+/**
+ * @brief Sample every examplesensor instance, one port read per GPIO port
+ *
+ * Instances are grouped by the GPIO port of their input pin when they are
+ * initialized. This function reads each port once with gpio_port_get_raw()
+ * and updates the state of all the instances on it, so a following
+ * sensor_channel_get() on any instance returns the new value without a
+ * sensor_sample_fetch() of its own.
+ *
+ * @retval 0 on success
+ * @retval -errno the error of the first port read that failed; the other
+ *         ports are still sampled
+ */
+int examplesensor_bank_fetch(void);
+
+/**
+ * @brief Get the states sampled by the last bank fetch on one port
+ *
+ * @param port GPIO port device
+ * @param[out] states Bitmap of logical pin states (GPIO_ACTIVE_LOW already
+ *             applied); only pins with a sensor can be set
+ * @param[out] mask Optional, bitmap of the pins that have a sensor
+ *
+ * @retval 0 on success
+ * @retval -ENOENT if no examplesensor uses that port
+ */
+int examplesensor_bank_get(const struct device *port, gpio_port_pins_t *states,
+			   gpio_port_pins_t *mask);
+
+#endif /* EXAMPLE_APPLICATION_INCLUDE_APP_DRIVERS_EXAMPLESENSOR_H_ */
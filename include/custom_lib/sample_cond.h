@@ -0,0 +1,99 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef EXAMPLE_APPLICATION_INCLUDE_CUSTOM_LIB_SAMPLE_COND_H_
+#define EXAMPLE_APPLICATION_INCLUDE_CUSTOM_LIB_SAMPLE_COND_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Sample conditioning kernels
+ *
+ * Block kernels for ADC samples. On cores with the DSP extension
+ * (Cortex-M4 and up) they process two samples per 32-bit operation;
+ * elsewhere, or with CONFIG_CUSTOM_LIB_SAMPLE_COND_PORTABLE, portable C
+ * versions with bit-identical results are built instead.
+ *
+ * Q15 samples are centred on the ADC mid-scale: code 2048 maps to 0 and
+ * one 12-bit count to 16 Q15 counts.
+ */
+
+/** @brief Gain of 1.0 for sample_cond_gain_offset() */
+#define SAMPLE_COND_GAIN_ONE (1 << 14)
+
+/** @brief Running DC estimate, see sample_cond_dc_remove() */
+struct sample_cond_dc {
+	/** Estimate in Q15 with 8 extra fractional bits */
+	int32_t dc;
+	/** Time constant, as a power of two of blocks */
+	uint8_t shift;
+	/** False until the first block has been seen */
+	bool primed;
+};
+
+/**
+ * @brief Convert unsigned 12-bit samples to Q15
+ *
+ * Only the low 12 bits of each input are used. @p dst may be the same
+ * buffer as @p src.
+ *
+ * @param src Unsigned 12-bit samples
+ * @param dst Q15 output
+ * @param n Number of samples
+ */
+void sample_cond_u12_to_q15(const uint16_t *src, int16_t *dst, size_t n);
+
+/**
+ * @brief Apply a gain and offset correction in place
+ *
+ * Computes x * gain / 2^14 + offset, rounded to nearest and saturated to
+ * 16 bits.
+ *
+ * @param buf Q15 samples
+ * @param n Number of samples
+ * @param gain_q14 Gain in Q2.14 (SAMPLE_COND_GAIN_ONE is unity)
+ * @param offset Offset in Q15 counts
+ */
+void sample_cond_gain_offset(int16_t *buf, size_t n, int16_t gain_q14, int16_t offset);
+
+/**
+ * @brief Reset a running DC estimate
+ *
+ * @param state Estimate to reset
+ * @param shift Time constant: each block moves the estimate by
+ *              1 / 2^shift of the distance to the block mean. With 0
+ *              each block has its own mean removed.
+ */
+void sample_cond_dc_init(struct sample_cond_dc *state, uint8_t shift);
+
+/**
+ * @brief Track the DC level and subtract it in place
+ *
+ * Folds the mean of the block into the running estimate (the first block
+ * after sample_cond_dc_init() sets it directly), then subtracts the
+ * estimate from every sample with 16-bit saturation.
+ *
+ * @param state Running estimate
+ * @param buf Q15 samples
+ * @param n Number of samples, at most 65536
+ * @returns The DC level removed, in Q15
+ */
+int16_t sample_cond_dc_remove(struct sample_cond_dc *state, int16_t *buf, size_t n);
+
+/**
+ * @brief Convert Q15 samples to complex floats with zero imaginary part
+ *
+ * Writes dst[2i] = src[i] * scale and dst[2i + 1] = 0, the input layout
+ * of the CMSIS-DSP complex FFT.
+ *
+ * @param src Q15 samples
+ * @param dst Output, 2 * @p n floats
+ * @param n Number of samples
+ * @param scale Value of one Q15 count
+ */
+void sample_cond_q15_to_cf32(const int16_t *src, float *dst, size_t n, float scale);
+
+#endif /* EXAMPLE_APPLICATION_INCLUDE_CUSTOM_LIB_SAMPLE_COND_H_ */
@@ -0,0 +1,200 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <custom_lib/sample_cond.h>
+
+#include <string.h>
+
+#if defined(__ARM_FEATURE_DSP) && defined(__ARM_FEATURE_SIMD32) && \
+	!defined(CONFIG_CUSTOM_LIB_SAMPLE_COND_PORTABLE)
+#include <arm_acle.h>
+#define SAMPLE_COND_SIMD 1
+#endif
+
+/* Adds the rounding half and the offset of sample_cond_gain_offset() */
+#define GAIN_OFFSET_BIAS(offset) (((int32_t)(offset) * (1 << 14)) + (1 << 13))
+
+static inline int16_t sat16(int32_t x)
+{
+	return (x > INT16_MAX) ? INT16_MAX : ((x < INT16_MIN) ? INT16_MIN : (int16_t)x);
+}
+
+#if defined(SAMPLE_COND_SIMD)
+
+/* Two samples per word. The buffers are only 2-byte aligned, and the M4
+ * handles unaligned word accesses, so go through memcpy (a single LDR/STR).
+ */
+static inline uint32_t read2(const void *p)
+{
+	uint32_t w;
+
+	memcpy(&w, p, sizeof(w));
+	return w;
+}
+
+static inline void write2(void *p, uint32_t w)
+{
+	memcpy(p, &w, sizeof(w));
+}
+
+void sample_cond_u12_to_q15(const uint16_t *src, int16_t *dst, size_t n)
+{
+	size_t i;
+
+	/* (x << 4) - 0x8000 on each halfword: x << 4 keeps within the
+	 * halfword, and subtracting 0x8000 modulo 2^16 is flipping bit 15
+	 */
+	for (i = 0; i + 2 <= n; i += 2) {
+		uint32_t w = read2(&src[i]);
+
+		write2(&dst[i], ((w & 0x0fff0fffU) << 4) ^ 0x80008000U);
+	}
+
+	if (i < n) {
+		dst[i] = (int16_t)(((src[i] & 0x0fffU) << 4) ^ 0x8000U);
+	}
+}
+
+void sample_cond_gain_offset(int16_t *buf, size_t n, int16_t gain_q14, int16_t offset)
+{
+	const int32_t bias = GAIN_OFFSET_BIAS(offset);
+	const int32_t gain = gain_q14;
+	size_t i;
+
+	for (i = 0; i + 2 <= n; i += 2) {
+		int32_t w = (int32_t)read2(&buf[i]);
+		int32_t lo = __ssat(__smlabb(w, gain, bias) >> 14, 16);
+		int32_t hi = __ssat(__smlatb(w, gain, bias) >> 14, 16);
+
+		write2(&buf[i], ((uint32_t)lo & 0xffffU) | ((uint32_t)hi << 16));
+	}
+
+	if (i < n) {
+		buf[i] = sat16((((int32_t)buf[i] * gain) + bias) >> 14);
+	}
+}
+
+static int32_t block_sum(const int16_t *buf, size_t n)
+{
+	int32_t sum = 0;
+	size_t i;
+
+	for (i = 0; i + 2 <= n; i += 2) {
+		sum = __smlad((int32_t)read2(&buf[i]), 0x00010001, sum);
+	}
+
+	if (i < n) {
+		sum += buf[i];
+	}
+
+	return sum;
+}
+
+static void block_sub(int16_t *buf, size_t n, int16_t dc)
+{
+	const uint32_t dc2 = ((uint32_t)(uint16_t)dc << 16) | (uint16_t)dc;
+	size_t i;
+
+	for (i = 0; i + 2 <= n; i += 2) {
+		write2(&buf[i], (uint32_t)__qsub16((int16x2_t)read2(&buf[i]), (int16x2_t)dc2));
+	}
+
+	if (i < n) {
+		buf[i] = sat16((int32_t)buf[i] - dc);
+	}
+}
+
+void sample_cond_q15_to_cf32(const int16_t *src, float *dst, size_t n, float scale)
+{
+	size_t i;
+
+	for (i = 0; i + 2 <= n; i += 2) {
+		uint32_t w = read2(&src[i]);
+
+		dst[2 * i] = (float)(int16_t)w * scale;
+		dst[(2 * i) + 1] = 0.0f;
+		dst[(2 * i) + 2] = (float)(int16_t)(w >> 16) * scale;
+		dst[(2 * i) + 3] = 0.0f;
+	}
+
+	if (i < n) {
+		dst[2 * i] = (float)src[i] * scale;
+		dst[(2 * i) + 1] = 0.0f;
+	}
+}
+
+#else /* SAMPLE_COND_SIMD */
+
+void sample_cond_u12_to_q15(const uint16_t *src, int16_t *dst, size_t n)
+{
+	for (size_t i = 0; i < n; i++) {
+		dst[i] = (int16_t)(((src[i] & 0x0fffU) << 4) ^ 0x8000U);
+	}
+}
+
+void sample_cond_gain_offset(int16_t *buf, size_t n, int16_t gain_q14, int16_t offset)
+{
+	const int32_t bias = GAIN_OFFSET_BIAS(offset);
+
+	for (size_t i = 0; i < n; i++) {
+		buf[i] = sat16((((int32_t)buf[i] * gain_q14) + bias) >> 14);
+	}
+}
+
+static int32_t block_sum(const int16_t *buf, size_t n)
+{
+	int32_t sum = 0;
+
+	for (size_t i = 0; i < n; i++) {
+		sum += buf[i];
+	}
+
+	return sum;
+}
+
+static void block_sub(int16_t *buf, size_t n, int16_t dc)
+{
+	for (size_t i = 0; i < n; i++) {
+		buf[i] = sat16((int32_t)buf[i] - dc);
+	}
+}
+
+void sample_cond_q15_to_cf32(const int16_t *src, float *dst, size_t n, float scale)
+{
+	for (size_t i = 0; i < n; i++) {
+		dst[2 * i] = (float)src[i] * scale;
+		dst[(2 * i) + 1] = 0.0f;
+	}
+}
+
+#endif /* SAMPLE_COND_SIMD */
+
+void sample_cond_dc_init(struct sample_cond_dc *state, uint8_t shift)
+{
+	state->dc = 0;
+	state->shift = shift;
+	state->primed = false;
+}
+
+int16_t sample_cond_dc_remove(struct sample_cond_dc *state, int16_t *buf, size_t n)
+{
+	if (n == 0) {
+		return 0;
+	}
+
+	int32_t mean = (block_sum(buf, n) / (int32_t)n) * (1 << 8);
+
+	if (state->primed) {
+		state->dc += (mean - state->dc) >> state->shift;
+	} else {
+		state->dc = mean;
+		state->primed = true;
+	}
+
+	int16_t dc = sat16((state->dc + (1 << 7)) >> 8);
+
+	block_sub(buf, n, dc);
+
+	return dc;
+}
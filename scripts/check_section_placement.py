@@ -0,0 +1,83 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: Apache-2.0
+
+'''check_section_placement.py
+
+Check in a GNU ld map file that the given symbols were linked inside a
+memory window. Used by the application build to verify what was placed in
+the STM32G4 CCM SRAM.
+
+A name matches either a global symbol line or an input section whose name
+ends in ".<name>" (as produced by -ffunction-sections/-fdata-sections), so
+static objects and library functions can be checked too.'''
+
+import argparse
+import re
+import sys
+
+
+def find_addresses(map_lines, name):
+    '''Return every address the map file gives for name.'''
+    symbol = re.compile(r'^\s+0x([0-9a-fA-F]+)\s+' + re.escape(name) + r'\s*$')
+    section = re.compile(r'^\s*\.\S*\.' + re.escape(name) + r'(?=\s|$)(\s+0x([0-9a-fA-F]+))?')
+    address = re.compile(r'^\s+0x([0-9a-fA-F]+)\s+0x[0-9a-fA-F]+\s')
+
+    found = []
+    for i, line in enumerate(map_lines):
+        m = symbol.match(line)
+        if m:
+            found.append(int(m.group(1), 16))
+            continue
+
+        m = section.match(line)
+        if not m:
+            continue
+        if m.group(2):
+            found.append(int(m.group(2), 16))
+        elif i + 1 < len(map_lines):
+            # Long section names push the address to the next line
+            m = address.match(map_lines[i + 1])
+            if m:
+                found.append(int(m.group(1), 16))
+
+    # Discarded input sections are listed at address 0
+    return [a for a in found if a != 0]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n\n')[1])
+    parser.add_argument('--map', required=True, help='linker map file')
+    parser.add_argument('--base', required=True, type=lambda x: int(x, 0),
+                        help='start address of the memory window')
+    parser.add_argument('--size', required=True, type=lambda x: int(x, 0),
+                        help='size of the memory window in bytes')
+    parser.add_argument('--region', default='region',
+                        help='name of the window, for messages only')
+    parser.add_argument('names', nargs='+', help='symbols that must be inside')
+    args = parser.parse_args()
+
+    with open(args.map, encoding='utf-8', errors='replace') as f:
+        map_lines = f.read().splitlines()
+
+    end = args.base + args.size
+    errors = 0
+    for name in args.names:
+        addresses = find_addresses(map_lines, name)
+        if not addresses:
+            print(f'error: {name} not found in {args.map}')
+            errors += 1
+            continue
+
+        outside = [a for a in addresses if not args.base <= a < end]
+        if outside:
+            print(f'error: {name} at 0x{outside[0]:08x}, outside {args.region} '
+                  f'(0x{args.base:08x}-0x{end - 1:08x})')
+            errors += 1
+        else:
+            print(f'{name}: 0x{addresses[0]:08x} in {args.region}')
+
+    return 1 if errors else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
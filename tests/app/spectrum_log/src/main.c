@@ -0,0 +1,264 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/flash/flash_simulator.h>
+#include <zephyr/storage/flash_map.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/ztest.h>
+
+#include <string.h>
+
+#include "spectrum_log.h"
+
+#define STORAGE_OFFSET FIXED_PARTITION_OFFSET(storage_partition)
+#define STORAGE_SIZE FIXED_PARTITION_SIZE(storage_partition)
+
+/* Upper bound on the records appended to fill the partition and wrap */
+#define MAX_RECORDS 8192
+#define WRAP_CHECK_EVERY 32
+#define WRITER_TIMEOUT_MS 1000
+
+struct walk_result {
+	uint32_t valid;
+	uint32_t invalid;
+	uint32_t first_seq;
+	uint32_t last_seq;
+	bool gap;
+	struct spectrum_log_record last;
+};
+
+static int collect_cb(const struct spectrum_log_record *rec, int err, void *arg)
+{
+	struct walk_result *res = arg;
+
+	if (err != 0) {
+		zassert_equal(err, -EBADMSG);
+		res->invalid++;
+		return 0;
+	}
+
+	if (res->valid == 0) {
+		res->first_seq = rec->seq;
+	} else if (rec->seq != res->last_seq + 1) {
+		res->gap = true;
+	}
+
+	res->last_seq = rec->seq;
+	res->last = *rec;
+	res->valid++;
+
+	return 0;
+}
+
+static void walk(struct walk_result *res)
+{
+	*res = (struct walk_result){0};
+	zassert_ok(spectrum_log_walk(collect_cb, res));
+}
+
+static void append(uint32_t frame, float tag)
+{
+	struct spectrum_log_record rec = {.frame = frame, .uptime_ms = frame};
+
+	for (int i = 0; i < CONFIG_APP_SPECTRUM_LOG_BINS; i++) {
+		rec.bins[i] = tag + (float)i;
+	}
+
+	zassert_ok(spectrum_log_append(&rec), "frame %u", frame);
+}
+
+/* The storage partition, straight from the flash simulator memory */
+static uint8_t *storage(void)
+{
+	size_t size;
+	uint8_t *mem = flash_simulator_get_memory(FIXED_PARTITION_DEVICE(storage_partition), &size);
+
+	zassert_not_null(mem);
+	zassert_true(STORAGE_OFFSET + STORAGE_SIZE <= size);
+
+	return mem + STORAGE_OFFSET;
+}
+
+static void before_each(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	/* Also waits for the mount done by the writer thread at boot */
+	zassert_ok(spectrum_log_init());
+	zassert_ok(spectrum_log_clear());
+}
+
+ZTEST(spectrum_log, test_append)
+{
+	struct walk_result res;
+	uint32_t seq = spectrum_log_next_seq();
+
+	for (uint32_t i = 0; i < 5; i++) {
+		append(i, 100.0f);
+	}
+
+	walk(&res);
+	zassert_equal(res.valid, 5);
+	zassert_equal(res.invalid, 0);
+	zassert_false(res.gap);
+	zassert_equal(res.first_seq, seq);
+	zassert_equal(res.last_seq, seq + 4);
+	zassert_equal(spectrum_log_next_seq(), seq + 5);
+
+	zassert_equal(res.last.frame, 4);
+	zassert_equal(res.last.uptime_ms, 4);
+	for (int i = 0; i < CONFIG_APP_SPECTRUM_LOG_BINS; i++) {
+		zassert_equal(res.last.bins[i], 100.0f + (float)i);
+	}
+}
+
+ZTEST(spectrum_log, test_wrap)
+{
+	struct walk_result res;
+	uint32_t seq = spectrum_log_next_seq();
+	uint32_t appended = 0;
+	bool wrapped = false;
+
+	/* Fill the partition until the oldest sector is rotated out */
+	while (!wrapped && (appended < MAX_RECORDS)) {
+		append(appended++, 0.0f);
+
+		if ((appended % WRAP_CHECK_EVERY) == 0) {
+			walk(&res);
+			wrapped = res.first_seq != seq;
+		}
+	}
+	zassert_true(wrapped, "no rotation after %u records", appended);
+
+	/* And keep going across a few more sector boundaries */
+	for (uint32_t i = 0; i < appended / 2; i++) {
+		append(appended + i, 0.0f);
+	}
+	appended += appended / 2;
+
+	walk(&res);
+	zassert_equal(res.invalid, 0);
+	zassert_false(res.gap, "records lost in the middle of the log");
+	zassert_true(res.valid < appended);
+	zassert_true(res.first_seq > seq);
+	zassert_equal(res.last_seq, seq + appended - 1);
+	zassert_equal(spectrum_log_next_seq(), seq + appended);
+}
+
+ZTEST(spectrum_log, test_crc_rejection)
+{
+	/* A value whose bytes are easy to find in the partition */
+	static const float marker = 4242.125f;
+	struct walk_result res;
+	uint8_t *mem = storage();
+	uint8_t *hit = NULL;
+
+	append(0, 1.0f);
+	append(1, marker);
+	append(2, 1.0f);
+
+	for (size_t off = 0; (off + sizeof(marker)) <= STORAGE_SIZE; off++) {
+		if (memcmp(&mem[off], &marker, sizeof(marker)) == 0) {
+			hit = &mem[off];
+			break;
+		}
+	}
+	zassert_not_null(hit, "record not found in the partition");
+
+	/* FCB checks each element with its own CRC-8 and silently skips the
+	 * ones that fail. An error that is a multiple of that polynomial
+	 * (x^8 + x^2 + x + 1, bits taken MSB first) goes through it, so only
+	 * the record CRC32 can catch it.
+	 */
+	hit[0] ^= 0x01;
+	hit[1] ^= 0x07;
+
+	walk(&res);
+	zassert_equal(res.valid, 2);
+	zassert_equal(res.invalid, 1);
+	zassert_equal(res.last.frame, 2);
+
+	/* The sequence still continues after the last valid record */
+	uint32_t next = spectrum_log_next_seq();
+
+	zassert_ok(spectrum_log_init());
+	zassert_equal(spectrum_log_next_seq(), next);
+}
+
+ZTEST(spectrum_log, test_seq_across_reinit)
+{
+	struct walk_result res;
+
+	for (uint32_t i = 0; i < 4; i++) {
+		append(i, 0.0f);
+	}
+
+	uint32_t next = spectrum_log_next_seq();
+
+	/* Mount again, as after a reset */
+	zassert_ok(spectrum_log_init());
+	zassert_equal(spectrum_log_next_seq(), next);
+
+	append(4, 0.0f);
+
+	walk(&res);
+	zassert_equal(res.valid, 5);
+	zassert_false(res.gap);
+	zassert_equal(res.last_seq, next);
+}
+
+ZTEST(spectrum_log, test_foreign_format)
+{
+	struct walk_result res;
+	uint8_t *mem = storage();
+
+	append(0, 0.0f);
+
+	/* Another magic in the first sector header */
+	memset(mem, 0x5a, 4);
+
+	zassert_ok(spectrum_log_init());
+
+	walk(&res);
+	zassert_equal(res.valid, 0);
+	zassert_equal(res.invalid, 0);
+
+	append(1, 0.0f);
+	walk(&res);
+	zassert_equal(res.valid, 1);
+}
+
+ZTEST(spectrum_log, test_add)
+{
+	static float mag[CONFIG_APP_SPECTRUM_LOG_FIRST_BIN + CONFIG_APP_SPECTRUM_LOG_BINS];
+	struct walk_result res;
+
+	for (size_t i = 0; i < ARRAY_SIZE(mag); i++) {
+		mag[i] = (float)i;
+	}
+
+	/* One record per CONFIG_APP_SPECTRUM_LOG_INTERVAL frames, written by
+	 * the writer thread one record per batch
+	 */
+	for (int frame = 0; frame < CONFIG_APP_SPECTRUM_LOG_INTERVAL; frame++) {
+		spectrum_log_add(mag, ARRAY_SIZE(mag));
+	}
+
+	for (int waited = 0; waited < WRITER_TIMEOUT_MS; waited += 10) {
+		walk(&res);
+		if (res.valid > 0) {
+			break;
+		}
+		k_msleep(10);
+	}
+
+	zassert_equal(res.valid, 1, "the writer thread wrote %u records", res.valid);
+	for (int i = 0; i < CONFIG_APP_SPECTRUM_LOG_BINS; i++) {
+		zassert_equal(res.last.bins[i], (float)(CONFIG_APP_SPECTRUM_LOG_FIRST_BIN + i),
+			      "bin %d", i);
+	}
+}
+
+ZTEST_SUITE(spectrum_log, NULL, NULL, before_each, NULL, NULL);
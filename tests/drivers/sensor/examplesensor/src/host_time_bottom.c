@@ -0,0 +1,18 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Built into the native simulator runner, on the host side of the
+ * native_sim boundary: the embedded image has no access to the host libc.
+ */
+
+#include <stdint.h>
+#include <time.h>
+
+uint64_t examplesensor_test_host_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ((uint64_t)ts.tv_sec * 1000000000u) + (uint64_t)ts.tv_nsec;
+}
@@ -0,0 +1,234 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/device.h>
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/drivers/gpio/gpio_emul.h>
+#include <zephyr/drivers/sensor.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/ztest.h>
+
+#include <string.h>
+
+#include <app/drivers/examplesensor.h>
+
+#define BENCH_ROUNDS 10000
+
+#define SENSOR_DEV(node_id) DEVICE_DT_GET(node_id),
+#define SENSOR_INPUT(node_id) GPIO_DT_SPEC_GET(node_id, input_gpios),
+
+static const struct device *const sensors[] = {
+	DT_FOREACH_STATUS_OKAY(zephyr_examplesensor, SENSOR_DEV)
+};
+
+static const struct gpio_dt_spec inputs[] = {
+	DT_FOREACH_STATUS_OKAY(zephyr_examplesensor, SENSOR_INPUT)
+};
+
+static const struct device *const ports[] = {
+	DEVICE_DT_GET(DT_NODELABEL(gpio0)),
+	DEVICE_DT_GET(DT_NODELABEL(gpio1)),
+};
+
+/* Raw level last driven on each port */
+static gpio_port_value_t levels[ARRAY_SIZE(ports)];
+
+static uint32_t rng_state;
+
+/* Host monotonic clock, from host_time_bottom.c */
+extern uint64_t examplesensor_test_host_ns(void);
+
+static uint32_t rng(void)
+{
+	/* xorshift32, reproducible across runs */
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 17;
+	rng_state ^= rng_state << 5;
+
+	return rng_state;
+}
+
+static size_t port_index(const struct device *port)
+{
+	for (size_t p = 0; p < ARRAY_SIZE(ports); p++) {
+		if (ports[p] == port) {
+			return p;
+		}
+	}
+
+	zassert_unreachable("sensor on an unexpected port %s", port->name);
+
+	return 0;
+}
+
+static gpio_port_pins_t sensor_pins(size_t p)
+{
+	gpio_port_pins_t pins = 0;
+
+	for (size_t i = 0; i < ARRAY_SIZE(inputs); i++) {
+		if (inputs[i].port == ports[p]) {
+			pins |= BIT(inputs[i].pin);
+		}
+	}
+
+	return pins;
+}
+
+/* Logical state of sensor i for the levels last driven */
+static int expected_state(size_t i)
+{
+	int raw = (levels[port_index(inputs[i].port)] & BIT(inputs[i].pin)) != 0;
+
+	return raw ^ ((inputs[i].dt_flags & GPIO_ACTIVE_LOW) != 0);
+}
+
+static void drive_random_levels(void)
+{
+	for (size_t p = 0; p < ARRAY_SIZE(ports); p++) {
+		gpio_port_pins_t pins = sensor_pins(p);
+
+		levels[p] = rng() & pins;
+		zassert_ok(gpio_emul_input_set_masked(ports[p], pins, levels[p]));
+	}
+}
+
+static void check_states(const char *how, int round)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(sensors); i++) {
+		struct sensor_value val;
+
+		zassert_ok(sensor_channel_get(sensors[i], SENSOR_CHAN_PROX, &val));
+		zassert_equal(val.val1, expected_state(i), "%s, round %d: %s is %d, expected %d",
+			      how, round, sensors[i]->name, val.val1, expected_state(i));
+	}
+}
+
+static void before_each(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	rng_state = 0x2545f491;
+}
+
+ZTEST(examplesensor, test_ready)
+{
+	zassert_equal(ARRAY_SIZE(sensors), 24);
+
+	for (size_t i = 0; i < ARRAY_SIZE(sensors); i++) {
+		zassert_true(device_is_ready(sensors[i]), "%s not ready", sensors[i]->name);
+	}
+}
+
+ZTEST(examplesensor, test_channel)
+{
+	struct sensor_value val;
+
+	zassert_ok(sensor_sample_fetch(sensors[0]));
+	zassert_equal(sensor_channel_get(sensors[0], SENSOR_CHAN_AMBIENT_TEMP, &val), -ENOTSUP);
+}
+
+ZTEST(examplesensor, test_sample_fetch)
+{
+	for (int round = 0; round < 32; round++) {
+		drive_random_levels();
+
+		for (size_t i = 0; i < ARRAY_SIZE(sensors); i++) {
+			zassert_ok(sensor_sample_fetch(sensors[i]));
+		}
+
+		check_states("sensor_sample_fetch", round);
+	}
+}
+
+ZTEST(examplesensor, test_bank_get)
+{
+	gpio_port_pins_t states;
+	gpio_port_pins_t mask;
+
+	for (size_t p = 0; p < ARRAY_SIZE(ports); p++) {
+		zassert_ok(examplesensor_bank_get(ports[p], &states, &mask));
+		zassert_equal(mask, sensor_pins(p), "%s: mask 0x%08x, expected 0x%08x",
+			      ports[p]->name, mask, sensor_pins(p));
+		zassert_ok(examplesensor_bank_get(ports[p], &states, NULL));
+	}
+
+	zassert_equal(examplesensor_bank_get(DEVICE_DT_GET(DT_NODELABEL(gpio2)), &states, &mask),
+		      -ENOENT);
+}
+
+ZTEST(examplesensor, test_bank_fetch)
+{
+	for (int round = 0; round < 32; round++) {
+		drive_random_levels();
+		zassert_ok(examplesensor_bank_fetch());
+
+		for (size_t p = 0; p < ARRAY_SIZE(ports); p++) {
+			gpio_port_pins_t expected = 0;
+			gpio_port_pins_t states;
+
+			for (size_t i = 0; i < ARRAY_SIZE(inputs); i++) {
+				if ((inputs[i].port == ports[p]) && expected_state(i)) {
+					expected |= BIT(inputs[i].pin);
+				}
+			}
+
+			zassert_ok(examplesensor_bank_get(ports[p], &states, NULL));
+			zassert_equal(states, expected, "round %d, %s: states 0x%08x, expected 0x%08x",
+				      round, ports[p]->name, states, expected);
+		}
+
+		check_states("examplesensor_bank_fetch", round);
+	}
+
+	/* The states are the ones sampled, not the current levels */
+	gpio_port_value_t sampled[ARRAY_SIZE(ports)];
+
+	memcpy(sampled, levels, sizeof(levels));
+	for (size_t p = 0; p < ARRAY_SIZE(ports); p++) {
+		levels[p] = ~sampled[p] & sensor_pins(p);
+		zassert_ok(gpio_emul_input_set_masked(ports[p], sensor_pins(p), levels[p]));
+	}
+	memcpy(levels, sampled, sizeof(levels));
+
+	check_states("after the levels changed", 0);
+}
+
+ZTEST(examplesensor, test_bench)
+{
+	uint64_t start;
+	uint64_t per_instance;
+	uint64_t bank;
+
+	drive_random_levels();
+
+	start = examplesensor_test_host_ns();
+	for (int round = 0; round < BENCH_ROUNDS; round++) {
+		for (size_t i = 0; i < ARRAY_SIZE(sensors); i++) {
+			sensor_sample_fetch(sensors[i]);
+		}
+	}
+	per_instance = examplesensor_test_host_ns() - start;
+
+	start = examplesensor_test_host_ns();
+	for (int round = 0; round < BENCH_ROUNDS; round++) {
+		examplesensor_bank_fetch();
+	}
+	bank = examplesensor_test_host_ns() - start;
+
+	/* The timed loops must not have broken the sampled states */
+	check_states("examplesensor_bank_fetch", BENCH_ROUNDS);
+
+	TC_PRINT("%zu sensors on %zu ports, %d rounds, host time\n", ARRAY_SIZE(sensors),
+		 ARRAY_SIZE(ports), BENCH_ROUNDS);
+	TC_PRINT("sensor_sample_fetch each  %6u ns per round, %zu pin reads\n",
+		 (uint32_t)(per_instance / BENCH_ROUNDS), ARRAY_SIZE(sensors));
+	TC_PRINT("examplesensor_bank_fetch  %6u ns per round, %zu port reads\n",
+		 (uint32_t)(bank / BENCH_ROUNDS), ARRAY_SIZE(ports));
+	if (bank > 0) {
+		TC_PRINT("bank fetch %u.%02ux faster\n", (uint32_t)(per_instance / bank),
+			 (uint32_t)(((per_instance % bank) * 100) / bank));
+	}
+}
+
+ZTEST_SUITE(examplesensor, NULL, NULL, before_each, NULL, NULL);
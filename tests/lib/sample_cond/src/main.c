@@ -0,0 +1,311 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/ztest.h>
+
+#include <string.h>
+
+#include <custom_lib/sample_cond.h>
+
+#if defined(__ARM_FEATURE_DSP) && defined(__ARM_FEATURE_SIMD32) && \
+	!defined(CONFIG_CUSTOM_LIB_SAMPLE_COND_PORTABLE)
+#define KERNELS "DSP extension"
+#else
+#define KERNELS "Portable C"
+#endif
+
+/* Odd, so the two-sample kernels also go through their tail */
+#define MAX_SAMPLES 257
+#define BENCH_SAMPLES 256
+#define BENCH_RUNS 8
+
+/* Block lengths covering the empty block, the tail alone and a full frame */
+static const size_t lengths[] = {0, 1, 2, 3, 64, 255, 256, MAX_SAMPLES};
+
+/* One spare element in front so every kernel is also run on buffers that
+ * are not 4-byte aligned
+ */
+static uint16_t raw[MAX_SAMPLES + 1];
+static int16_t buf[MAX_SAMPLES + 1];
+static int16_t expected[MAX_SAMPLES + 1];
+static float out[2 * MAX_SAMPLES];
+static float expected_out[2 * MAX_SAMPLES];
+
+static uint32_t rng_state;
+
+static uint32_t rng(void)
+{
+	/* xorshift32, reproducible across platforms */
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 17;
+	rng_state ^= rng_state << 5;
+
+	return rng_state;
+}
+
+static void fill_q15(int16_t *dst, size_t n)
+{
+	static const int16_t edges[] = {INT16_MIN, INT16_MIN + 1, -1, 0, 1, INT16_MAX - 1, INT16_MAX};
+
+	for (size_t i = 0; i < n; i++) {
+		dst[i] = (i < ARRAY_SIZE(edges)) ? edges[i] : (int16_t)rng();
+	}
+}
+
+/*
+ * Scalar references, written from the API documentation with 64-bit
+ * intermediates and explicit floor division, so they share no code with
+ * either implementation of the library.
+ */
+
+static int16_t ref_sat16(int64_t x)
+{
+	return (int16_t)CLAMP(x, INT16_MIN, INT16_MAX);
+}
+
+static int64_t ref_floor_div(int64_t a, int64_t b)
+{
+	int64_t q = a / b;
+
+	return ((a % b) != 0 && ((a < 0) != (b < 0))) ? q - 1 : q;
+}
+
+static void ref_u12_to_q15(const uint16_t *src, int16_t *dst, size_t n)
+{
+	for (size_t i = 0; i < n; i++) {
+		dst[i] = (int16_t)(((int32_t)(src[i] & 0x0fff) - 2048) * 16);
+	}
+}
+
+static void ref_gain_offset(int16_t *buf, size_t n, int16_t gain_q14, int16_t offset)
+{
+	for (size_t i = 0; i < n; i++) {
+		int64_t scaled = ref_floor_div(((int64_t)buf[i] * gain_q14) + (1 << 13), 1 << 14);
+
+		buf[i] = ref_sat16(scaled + offset);
+	}
+}
+
+struct ref_dc {
+	int64_t dc;
+	uint8_t shift;
+	bool primed;
+};
+
+static int16_t ref_dc_remove(struct ref_dc *state, int16_t *buf, size_t n)
+{
+	if (n == 0) {
+		return 0;
+	}
+
+	int64_t sum = 0;
+
+	for (size_t i = 0; i < n; i++) {
+		sum += buf[i];
+	}
+
+	/* The mean truncates towards zero, the tracking step rounds down */
+	int64_t mean = (sum / (int64_t)n) * 256;
+
+	if (state->primed) {
+		state->dc += ref_floor_div(mean - state->dc, (int64_t)1 << state->shift);
+	} else {
+		state->dc = mean;
+		state->primed = true;
+	}
+
+	int16_t dc = ref_sat16(ref_floor_div(state->dc + 128, 256));
+
+	for (size_t i = 0; i < n; i++) {
+		buf[i] = ref_sat16((int64_t)buf[i] - dc);
+	}
+
+	return dc;
+}
+
+static void ref_q15_to_cf32(const int16_t *src, float *dst, size_t n, float scale)
+{
+	for (size_t i = 0; i < n; i++) {
+		dst[2 * i] = (float)src[i] * scale;
+		dst[(2 * i) + 1] = 0.0f;
+	}
+}
+
+static void before_each(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	rng_state = 0x2545f491;
+}
+
+ZTEST(sample_cond, test_u12_to_q15)
+{
+	static const uint16_t codes[] = {0x0000, 0x0fff, 0x0800, 0x07ff, 0xf000, 0xffff};
+
+	for (size_t off = 0; off < 2; off++) {
+		for (size_t l = 0; l < ARRAY_SIZE(lengths); l++) {
+			size_t n = MIN(lengths[l], MAX_SAMPLES - off);
+
+			for (size_t i = 0; i < n; i++) {
+				/* Full 16-bit range: the upper bits must be ignored */
+				raw[off + i] = (i < ARRAY_SIZE(codes)) ? codes[i] : (uint16_t)rng();
+			}
+
+			ref_u12_to_q15(&raw[off], &expected[off], n);
+			sample_cond_u12_to_q15(&raw[off], &buf[off], n);
+
+			zassert_mem_equal(&buf[off], &expected[off], n * sizeof(int16_t),
+					  "n %zu, offset %zu", n, off);
+		}
+	}
+
+	/* In place, as documented */
+	for (size_t i = 0; i < MAX_SAMPLES; i++) {
+		raw[i] = (uint16_t)rng();
+	}
+	ref_u12_to_q15(raw, expected, MAX_SAMPLES);
+	sample_cond_u12_to_q15(raw, (int16_t *)raw, MAX_SAMPLES);
+
+	zassert_mem_equal(raw, expected, MAX_SAMPLES * sizeof(int16_t), "in place");
+}
+
+ZTEST(sample_cond, test_gain_offset)
+{
+	static const int16_t gains[] = {SAMPLE_COND_GAIN_ONE, 0, 1, -1, 16000, 17000,
+					INT16_MAX, INT16_MIN};
+	static const int16_t offsets[] = {0, 1, -1, 300, INT16_MAX, INT16_MIN};
+
+	for (size_t g = 0; g < ARRAY_SIZE(gains); g++) {
+		for (size_t o = 0; o < ARRAY_SIZE(offsets); o++) {
+			for (size_t off = 0; off < 2; off++) {
+				for (size_t l = 0; l < ARRAY_SIZE(lengths); l++) {
+					size_t n = MIN(lengths[l], MAX_SAMPLES - off);
+
+					fill_q15(&buf[off], n);
+					memcpy(&expected[off], &buf[off], n * sizeof(int16_t));
+
+					ref_gain_offset(&expected[off], n, gains[g], offsets[o]);
+					sample_cond_gain_offset(&buf[off], n, gains[g], offsets[o]);
+
+					zassert_mem_equal(&buf[off], &expected[off],
+							  n * sizeof(int16_t),
+							  "gain %d, offset %d, n %zu, offset %zu",
+							  gains[g], offsets[o], n, off);
+				}
+			}
+		}
+	}
+}
+
+ZTEST(sample_cond, test_dc_remove)
+{
+	static const uint8_t shifts[] = {0, 3, 15};
+
+	for (size_t s = 0; s < ARRAY_SIZE(shifts); s++) {
+		struct sample_cond_dc state;
+		struct ref_dc ref = {.shift = shifts[s]};
+
+		sample_cond_dc_init(&state, shifts[s]);
+
+		/* Random blocks with a moving DC level, then the saturation
+		 * edges: a large positive estimate followed by full-scale
+		 * negative blocks, and back.
+		 */
+		for (int block = 0; block < 24; block++) {
+			size_t n = lengths[(block % (ARRAY_SIZE(lengths) - 1)) + 1];
+			size_t off = block & 1;
+
+			if (block < 16) {
+				int16_t level = (int16_t)((block - 8) * 4000);
+
+				for (size_t i = 0; i < n; i++) {
+					buf[off + i] = ref_sat16((int64_t)level + ((int16_t)rng() / 4));
+				}
+			} else {
+				int16_t level = ((block / 2) & 1) ? INT16_MIN : INT16_MAX;
+
+				for (size_t i = 0; i < n; i++) {
+					buf[off + i] = (i & 1) ? level : (int16_t)(level / 2);
+				}
+			}
+
+			memcpy(&expected[off], &buf[off], n * sizeof(int16_t));
+
+			int16_t ref_dc = ref_dc_remove(&ref, &expected[off], n);
+			int16_t dc = sample_cond_dc_remove(&state, &buf[off], n);
+
+			zassert_equal(dc, ref_dc, "shift %u, block %d: dc %d, expected %d",
+				      shifts[s], block, dc, ref_dc);
+			zassert_mem_equal(&buf[off], &expected[off], n * sizeof(int16_t),
+					  "shift %u, block %d", shifts[s], block);
+		}
+
+		/* An empty block removes nothing */
+		zassert_equal(sample_cond_dc_remove(&state, buf, 0), 0);
+	}
+}
+
+ZTEST(sample_cond, test_q15_to_cf32)
+{
+	static const float scales[] = {1.0f, 1.0f / 32768.0f, 0.00005035400390625f, -3.0f};
+
+	for (size_t s = 0; s < ARRAY_SIZE(scales); s++) {
+		for (size_t off = 0; off < 2; off++) {
+			for (size_t l = 0; l < ARRAY_SIZE(lengths); l++) {
+				size_t n = MIN(lengths[l], MAX_SAMPLES - off);
+
+				fill_q15(&buf[off], n);
+
+				ref_q15_to_cf32(&buf[off], expected_out, n, scales[s]);
+				sample_cond_q15_to_cf32(&buf[off], out, n, scales[s]);
+
+				/* Bit-exact, not just within a tolerance */
+				zassert_mem_equal(out, expected_out, 2 * n * sizeof(float),
+						  "scale %f, n %zu, offset %zu", (double)scales[s], n,
+						  off);
+			}
+		}
+	}
+}
+
+/* Least cycles over a few runs of one kernel on BENCH_SAMPLES samples */
+#define BENCH(name, call)                                                                   \
+	do {                                                                                \
+		uint32_t best = UINT32_MAX;                                                 \
+                                                                                            \
+		for (int run = 0; run < BENCH_RUNS; run++) {                                \
+			uint32_t start = k_cycle_get_32();                                  \
+                                                                                            \
+			call;                                                               \
+			best = MIN(best, k_cycle_get_32() - start);                         \
+		}                                                                           \
+		TC_PRINT("%-24s %6u cycles, %u.%02u per sample\n", name, best,              \
+			 best / BENCH_SAMPLES, ((best % BENCH_SAMPLES) * 100) / BENCH_SAMPLES); \
+	} while (false)
+
+ZTEST(sample_cond, test_cycles)
+{
+	struct sample_cond_dc state;
+
+	/* Code takes no simulated time on the POSIX architecture */
+	Z_TEST_SKIP_IFDEF(CONFIG_ARCH_POSIX);
+
+	for (size_t i = 0; i < BENCH_SAMPLES; i++) {
+		raw[i] = (uint16_t)rng() & 0x0fff;
+	}
+
+	TC_PRINT("%s kernels, %u samples, k_cycle_get_32() at %u Hz\n", KERNELS, BENCH_SAMPLES,
+		 sys_clock_hw_cycles_per_sec());
+
+	BENCH("sample_cond_u12_to_q15", sample_cond_u12_to_q15(raw, buf, BENCH_SAMPLES));
+	BENCH("sample_cond_gain_offset", sample_cond_gain_offset(buf, BENCH_SAMPLES, 16000, 3));
+	BENCH("sample_cond_dc_remove", (sample_cond_dc_init(&state, 3),
+					 sample_cond_dc_remove(&state, buf, BENCH_SAMPLES)));
+	BENCH("sample_cond_q15_to_cf32",
+	      sample_cond_q15_to_cf32(buf, out, BENCH_SAMPLES, 1.0f / 32768.0f));
+}
+
+ZTEST_SUITE(sample_cond, NULL, NULL, before_each, NULL, NULL);